@@ -0,0 +1,310 @@
+/**
+ * @file    balance.c
+ * @brief   Work stealing between MPI processes with Safra's termination
+ *          detection algorithm.
+ * @author  L. Foxcroft
+ * @date    2022-06-10
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <mpi.h>
+#include "balance.h"
+
+/* message tags */
+#define TAG_REQUEST   1
+#define TAG_WORK      2
+#define TAG_REJECT    3
+#define TAG_TOKEN     4
+#define TAG_TERMINATE 5
+
+/* process and token colours */
+#define WHITE 0
+#define BLACK 1
+
+/* the fewest tours a process must have before it gives half of them away */
+#define MIN_SPLIT 2
+
+/** a load balancer container */
+struct balancer {
+	/** communicator reserved for load balancing messages */
+	MPI_Comm comm;
+	/** rank of this process */
+	int rank;
+	/** number of processes */
+	int size;
+	/** the next process to ask for work */
+	int victim;
+	/** whether we are waiting for a reply to a request for work */
+	Boolean requested;
+	/** work messages sent less work messages received */
+	int counter;
+	/** black if we have received work since we last passed on the token */
+	int colour;
+	/** whether this process is holding the token */
+	Boolean has_token;
+	/** the token's colour and count */
+	int token[2];
+	/** whether process 0 has sent the token around the ring */
+	Boolean round;
+	/** stack used to split off work for other processes */
+	Stack *spare;
+	/** copies of the work sent since the last checkpoint and in the interval
+	 * before it, or NULL if they are not kept */
+	Stack *sent[2];
+};
+
+/*--- function prototypes ----------------------------------------------------*/
+
+static void send_work(Balancer *balancer, Stack *stack, int dest);
+static void recv_work(Balancer *balancer, Stack *stack, MPI_Status *status);
+static Boolean pass_token(Balancer *balancer);
+static void finish(Balancer *balancer);
+
+/*--- balancer interface -----------------------------------------------------*/
+
+Balancer *balance_init(int n, Boolean keep_sent)
+{
+	Balancer *balancer = (Balancer *) malloc(sizeof(Balancer));
+
+	MPI_Comm_dup(MPI_COMM_WORLD, &balancer->comm);
+	MPI_Comm_rank(balancer->comm, &balancer->rank);
+	MPI_Comm_size(balancer->comm, &balancer->size);
+	balancer->victim = (balancer->rank + 1) % balancer->size;
+	balancer->requested = FALSE;
+	balancer->counter = 0;
+	balancer->colour = WHITE;
+	balancer->has_token = (balancer->rank == 0);
+	balancer->round = FALSE;
+	balancer->spare = stack_init(n);
+	balancer->sent[0] = keep_sent ? stack_init(n) : NULL;
+	balancer->sent[1] = keep_sent ? stack_init(n) : NULL;
+
+	return balancer;
+}
+
+void balance_poll(Balancer *balancer, Stack *stack)
+{
+	int flag;
+	MPI_Status status;
+
+	/* hold on to the token until we run out of work */
+	MPI_Iprobe(MPI_ANY_SOURCE, TAG_TOKEN, balancer->comm, &flag, &status);
+	if (flag) {
+		MPI_Recv(balancer->token, 2, MPI_INT, status.MPI_SOURCE, TAG_TOKEN,
+				balancer->comm, MPI_STATUS_IGNORE);
+		balancer->has_token = TRUE;
+	}
+
+	/* answer every process which is waiting on us for work */
+	MPI_Iprobe(MPI_ANY_SOURCE, TAG_REQUEST, balancer->comm, &flag, &status);
+	while (flag) {
+		MPI_Recv(NULL, 0, MPI_INT, status.MPI_SOURCE, TAG_REQUEST,
+				balancer->comm, MPI_STATUS_IGNORE);
+		send_work(balancer, stack, status.MPI_SOURCE);
+		MPI_Iprobe(MPI_ANY_SOURCE, TAG_REQUEST, balancer->comm, &flag, &status);
+	}
+}
+
+Boolean balance_requested(Balancer *balancer)
+{
+	int flag;
+
+	MPI_Iprobe(MPI_ANY_SOURCE, TAG_REQUEST, balancer->comm, &flag,
+			MPI_STATUS_IGNORE);
+	return flag ? TRUE : FALSE;
+}
+
+void balance_checkpoint(Balancer *balancer, Stack *stack, Boolean rotate)
+{
+	Stack *oldest = balancer->sent[1];
+
+	copy_stack(stack, balancer->sent[1]);
+	copy_stack(stack, balancer->sent[0]);
+	if (!rotate) {
+		return;
+	}
+
+	/* start a new interval, forgetting the oldest */
+	balancer->sent[1] = balancer->sent[0];
+	balancer->sent[0] = oldest;
+	clear_stack(oldest);
+}
+
+Boolean balance_get_work(Balancer *balancer, Stack *stack)
+{
+	MPI_Status status;
+
+	while (TRUE) {
+		/* we are idle, so the token can move on */
+		if (balancer->has_token && pass_token(balancer)) {
+			finish(balancer);
+			return FALSE;
+		}
+
+		/* ask the next process in line for work */
+		if (!balancer->requested && balancer->size > 1) {
+			MPI_Send(NULL, 0, MPI_INT, balancer->victim, TAG_REQUEST,
+					balancer->comm);
+			balancer->requested = TRUE;
+			balancer->victim = (balancer->victim + 1) % balancer->size;
+			if (balancer->victim == balancer->rank) {
+				balancer->victim = (balancer->victim + 1) % balancer->size;
+			}
+		}
+
+		MPI_Probe(MPI_ANY_SOURCE, MPI_ANY_TAG, balancer->comm, &status);
+		switch (status.MPI_TAG) {
+			case TAG_REQUEST:
+				MPI_Recv(NULL, 0, MPI_INT, status.MPI_SOURCE, TAG_REQUEST,
+						balancer->comm, MPI_STATUS_IGNORE);
+				send_work(balancer, stack, status.MPI_SOURCE);
+				break;
+			case TAG_REJECT:
+				MPI_Recv(NULL, 0, MPI_INT, status.MPI_SOURCE, TAG_REJECT,
+						balancer->comm, MPI_STATUS_IGNORE);
+				balancer->requested = FALSE;
+				break;
+			case TAG_WORK:
+				recv_work(balancer, stack, &status);
+				return TRUE;
+			case TAG_TOKEN:
+				MPI_Recv(balancer->token, 2, MPI_INT, status.MPI_SOURCE,
+						TAG_TOKEN, balancer->comm, MPI_STATUS_IGNORE);
+				balancer->has_token = TRUE;
+				break;
+			case TAG_TERMINATE:
+				MPI_Recv(NULL, 0, MPI_INT, status.MPI_SOURCE, TAG_TERMINATE,
+						balancer->comm, MPI_STATUS_IGNORE);
+				finish(balancer);
+				return FALSE;
+		}
+	}
+}
+
+void balance_free(Balancer *balancer)
+{
+	MPI_Comm_free(&balancer->comm);
+	free_stack(balancer->spare);
+	if (balancer->sent[0] != NULL) {
+		free_stack(balancer->sent[0]);
+		free_stack(balancer->sent[1]);
+	}
+	free(balancer);
+}
+
+/*--- utility functions ------------------------------------------------------*/
+
+/** Send half of the tours on our stack to dest, or a rejection if we don't
+ * have enough to share. */
+static void send_work(Balancer *balancer, Stack *stack, int dest)
+{
+	int length, *buffer;
+
+	if (stack_size(stack) < MIN_SPLIT) {
+		MPI_Send(NULL, 0, MPI_INT, dest, TAG_REJECT, balancer->comm);
+		return;
+	}
+
+	split_stack(stack, balancer->spare);
+	if (balancer->sent[0] != NULL) {
+		copy_stack(balancer->sent[0], balancer->spare);
+	}
+	buffer = (int *) malloc(sizeof(int) * packed_size(balancer->spare));
+	length = pack_stack(balancer->spare, buffer);
+	MPI_Send(buffer, length, MPI_INT, dest, TAG_WORK, balancer->comm);
+	free(buffer);
+
+	/* Safra's algorithm counts every message which makes a process active */
+	balancer->counter++;
+}
+
+/** Receive the tours another process has split off for us. */
+static void recv_work(Balancer *balancer, Stack *stack, MPI_Status *status)
+{
+	int length, *buffer;
+
+	MPI_Get_count(status, MPI_INT, &length);
+	buffer = (int *) malloc(sizeof(int) * length);
+	MPI_Recv(buffer, length, MPI_INT, status->MPI_SOURCE, TAG_WORK,
+			balancer->comm, MPI_STATUS_IGNORE);
+	unpack_stack(stack, buffer, length);
+	free(buffer);
+
+	balancer->counter--;
+	balancer->colour = BLACK;
+	balancer->requested = FALSE;
+}
+
+/** Pass the token on to the next process in the ring now that we are idle. When
+ * the token arrives back at process 0 it decides whether every process is idle
+ * with no work in flight, in which case it returns true. */
+static Boolean pass_token(Balancer *balancer)
+{
+	int next = (balancer->rank + 1) % balancer->size;
+
+	if (balancer->rank == 0) {
+		if (balancer->round && balancer->token[0] == WHITE
+				&& balancer->colour == WHITE
+				&& balancer->token[1] + balancer->counter == 0) {
+			return TRUE;
+		} else if (balancer->size == 1) {
+			return TRUE;
+		}
+		/* start a new round */
+		balancer->token[0] = WHITE;
+		balancer->token[1] = 0;
+		balancer->round = TRUE;
+	} else {
+		if (balancer->colour == BLACK) {
+			balancer->token[0] = BLACK;
+		}
+		balancer->token[1] += balancer->counter;
+	}
+
+	MPI_Send(balancer->token, 2, MPI_INT, next, TAG_TOKEN, balancer->comm);
+	balancer->colour = WHITE;
+	balancer->has_token = FALSE;
+
+	return FALSE;
+}
+
+/** Wind the search down once termination has been detected. Process 0 tells
+ * everyone else, then every process keeps rejecting requests for work until the
+ * reply to its own request has arrived and all processes have reached the same
+ * point, so that no messages are left behind. */
+static void finish(Balancer *balancer)
+{
+	int flag, done = 0;
+	Boolean joined = FALSE;
+	MPI_Request barrier;
+	MPI_Status status;
+
+	if (balancer->rank == 0) {
+		for (int i = 1; i < balancer->size; i++) {
+			MPI_Send(NULL, 0, MPI_INT, i, TAG_TERMINATE, balancer->comm);
+		}
+	}
+
+	while (!done) {
+		if (!balancer->requested && !joined) {
+			MPI_Ibarrier(balancer->comm, &barrier);
+			joined = TRUE;
+		}
+		if (joined) {
+			MPI_Test(&barrier, &done, MPI_STATUS_IGNORE);
+		}
+
+		MPI_Iprobe(MPI_ANY_SOURCE, MPI_ANY_TAG, balancer->comm, &flag, &status);
+		if (flag && status.MPI_TAG == TAG_REQUEST) {
+			MPI_Recv(NULL, 0, MPI_INT, status.MPI_SOURCE, TAG_REQUEST,
+					balancer->comm, MPI_STATUS_IGNORE);
+			MPI_Send(NULL, 0, MPI_INT, status.MPI_SOURCE, TAG_REJECT,
+					balancer->comm);
+		} else if (flag && status.MPI_TAG == TAG_REJECT) {
+			MPI_Recv(NULL, 0, MPI_INT, status.MPI_SOURCE, TAG_REJECT,
+					balancer->comm, MPI_STATUS_IGNORE);
+			balancer->requested = FALSE;
+		}
+	}
+}
@@ -0,0 +1,94 @@
+/**
+ * @file    balance.h
+ * @brief   Dynamic load balancing of partial tours between MPI processes.
+ * @author  L. Foxcroft
+ * @date    2022-06-10
+ */
+
+#ifndef BALANCE_H
+#define BALANCE_H
+
+#include "boolean.h"
+#include "stack.h"
+
+/** the container structure for the state of the load balancer */
+typedef struct balancer Balancer;
+
+/*--- function prototypes ----------------------------------------------------*/
+
+/**
+ * Sets up a load balancer for a search of a graph with n cities. Every process
+ * in MPI_COMM_WORLD should call this at the same time.
+ *
+ * @param[in]   n
+ *     the number of cities in the problem
+ * @param[in]   keep_sent
+ *     whether to keep copies of the work sent to other processes for
+ *     balance_checkpoint
+ * @return      a pointer to the load balancer
+ */
+Balancer *balance_init(int n, Boolean keep_sent);
+
+/**
+ * Answers any requests for work which other processes have sent us, by
+ * splitting our stack with split_stack and sending them half. Busy processes
+ * should call this every so often during their search.
+ *
+ * @param[in]     balancer
+ *     a pointer to the load balancer
+ * @param[in,out] stack
+ *     the stack of partial tours this process is working on
+ */
+void balance_poll(Balancer *balancer, Stack *stack);
+
+/**
+ * Returns whether another process is waiting on us for work, so that work kept
+ * somewhere other than the stack can be moved onto it before balance_poll.
+ *
+ * @param[in]   balancer
+ *     a pointer to the load balancer
+ * @return      true if a request for work is waiting to be answered
+ */
+Boolean balance_requested(Balancer *balancer);
+
+/**
+ * Asks the other processes for work once our stack is empty. Blocks until
+ * another process sends us partial tours or every process has run out of work,
+ * which is detected with Safra's token ring algorithm.
+ *
+ * @param[in]     balancer
+ *     a pointer to the load balancer
+ * @param[in,out] stack
+ *     the empty stack which any work received is pushed onto
+ * @return        true if we received work, or false if the search is over
+ */
+Boolean balance_get_work(Balancer *balancer, Stack *stack);
+
+/**
+ * Pushes copies of the work we have sent to other processes since the last but
+ * one call which rotated onto stack, to be saved with a checkpoint. A
+ * checkpoint taken on one process can miss work which was in flight to another
+ * when it took its own, and saving the work at both ends means none is lost as
+ * long as the receiver takes a checkpoint within a checkpoint interval of
+ * receiving it. The balancer must have been set up to keep the work it sends.
+ *
+ * @param[in]     balancer
+ *     a pointer to the load balancer
+ * @param[in,out] stack
+ *     the stack which the copies should be added to
+ * @param[in]     rotate
+ *     whether to start a new interval, forgetting the work sent before the
+ *     last one, which should only be done once per checkpoint interval
+ */
+void balance_checkpoint(Balancer *balancer, Stack *stack, Boolean rotate);
+
+/**
+ * Frees the space associated with the specified load balancer. Every process
+ * should call this at the same time.
+ *
+ * @param[in]   balancer
+ *     the load balancer to free
+ */
+void balance_free(Balancer *balancer);
+
+#endif /* BALANCE_H */
@@ -0,0 +1,71 @@
+#!/bin/sh
+#
+# End to end benchmark for travelling salesman: generates a fixed set of
+# instances with tspgen, solves each with tsp -v on every process count in
+# BENCH_NP, and prints one CSV row per run.
+#
+# Environment:
+#   BENCH_NP         process counts to run on (default "1 2 4")
+#   BENCH_THREADS    threads per process passed to tsp -t (default 1)
+#   BENCH_INSTANCES  kind:cities pairs passed to tspgen (default a few which
+#                    take up to a couple of seconds on one process)
+#   BENCH_SEED       seed passed to tspgen (default 1)
+#   BENCH_DIR        where instances are written (default a temporary
+#                    directory)
+#   MPIEXEC          launcher (default mpiexec), with extra flags in MPIFLAGS
+#
+
+BINDIR=${BINDIR:-../bin}
+MPIEXEC=${MPIEXEC:-mpiexec}
+BENCH_NP=${BENCH_NP:-"1 2 4"}
+BENCH_THREADS=${BENCH_THREADS:-1}
+BENCH_INSTANCES=${BENCH_INSTANCES:-"euclidean:40 euclidean:50 uniform:50 clustered:20 clustered:24 asymmetric:40"}
+BENCH_SEED=${BENCH_SEED:-1}
+
+if [ -z "$BENCH_DIR" ]; then
+	BENCH_DIR=$(mktemp -d) || exit 1
+	trap 'rm -rf "$BENCH_DIR"' EXIT
+fi
+
+echo "instance,kind,n,np,threads,seconds,cost,expanded,nodes_per_sec,efficiency,imbalance"
+
+for instance in $BENCH_INSTANCES; do
+	kind=${instance%:*}
+	n=${instance#*:}
+	name=$kind$n
+	graph=$BENCH_DIR/$name.txt
+	"$BINDIR/tspgen" -k "$kind" -s "$BENCH_SEED" "$n" > "$graph" || exit 1
+
+	# efficiency is measured against the first process count run
+	base=""
+	for np in $BENCH_NP; do
+		cost=$($MPIEXEC $MPIFLAGS -np "$np" "$BINDIR/tsp" -v \
+				-t "$BENCH_THREADS" < "$graph" 2> "$BENCH_DIR/stats" \
+				| tail -n 1)
+		stats=$(grep '^stats ' "$BENCH_DIR/stats" | tail -n 1)
+		if [ -z "$stats" ]; then
+			echo "$name: tsp failed on $np processes" >&2
+			cat "$BENCH_DIR/stats" >&2
+			continue
+		fi
+		set -- $stats
+		seconds=$3
+		expanded=$5
+		imbalance=$7
+		if [ -z "$base" ]; then
+			base=$seconds
+			base_np=$np
+		fi
+		awk -v name="$name" -v kind="$kind" -v n="$n" -v np="$np" \
+				-v threads="$BENCH_THREADS" -v seconds="$seconds" \
+				-v cost="$cost" -v expanded="$expanded" \
+				-v imbalance="$imbalance" -v base="$base" \
+				-v base_np="$base_np" 'BEGIN {
+			rate = (seconds > 0) ? expanded / seconds : 0
+			eff = (seconds > 0) ? base * base_np / (np * seconds) : 0
+			printf "%s,%s,%d,%d,%d,%.6f,%s,%d,%.0f,%.3f,%s\n", name,
+					kind, n, np, threads, seconds, cost, expanded, rate,
+					eff, imbalance
+		}'
+	done
+done
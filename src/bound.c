@@ -0,0 +1,703 @@
+/**
+ * @file    bound.c
+ * @brief   Cheap, spanning tree, 1-tree and assignment lower bounds on the cost
+ *          of completing a partial tour.
+ * @author  L. Foxcroft
+ * @date    2022-06-16
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <math.h>
+#include "bound.h"
+#include "kernel.h"
+
+/* subgradient steps taken for each 1-tree bound */
+#define ONE_TREE_ITERATIONS 30
+/* how much each subgradient step shrinks by */
+#define STEP_DECAY 0.9
+/* slack for rounding error when a real bound is rounded up to an integer */
+#define EPSILON 1e-6
+
+/** scratch space for computing bounds, private to one thread */
+struct bounds {
+	/** the graph being searched */
+	Graph *graph;
+	/** the fastest versions of the inner loops this processor supports */
+	const Kernels *kernels;
+	/** the number of cities in the graph */
+	int num_cities;
+	/** the bound used for partial tours of each number of cities */
+	Bound_kind *by_depth;
+	/** the sum of the two cheapest edges of each city but city 0 */
+	long *twice;
+	/** directed graphs: the cheapest arc leaving each city */
+	long *leave;
+	/** directed graphs: the cheapest arc entering each city */
+	long *enter;
+	/** the cities a partial tour has left to visit */
+	int *left;
+	/** the penalty added to every edge of each city left to visit */
+	double *pi;
+	/** the cheapest edge joining each city to the spanning tree so far */
+	double *key;
+	/** the city each city joined the spanning tree through */
+	int *parent;
+	/** the number of edges each city has in the spanning tree */
+	int *degree;
+	/** HUGE_VAL once each city has joined the spanning tree, else 0, so that
+	 * it can be added to costs instead of tested */
+	double *done;
+	/** the cost of each arc of the assignment problem, row by row, or NULL if
+	 * no depth uses the assignment bound */
+	long *cost;
+	/** the potential of each row of the assignment problem */
+	long *row_potential;
+	/** the potential of each column of the assignment problem */
+	long *col_potential;
+	/** the cheapest reduced cost of reaching each column so far */
+	long *slack;
+	/** the row assigned to each column, or 0 if there is none yet */
+	int *match;
+	/** the column each column was reached from */
+	int *way;
+	/** whether each column has been reached */
+	Boolean *used;
+};
+
+/* the names of the bounds, in the order of Bound_kind */
+static const char *bound_names[] = {"cheap", "mst", "1tree", "assign"};
+
+/*--- function prototypes ----------------------------------------------------*/
+
+static long cheap_bound(Bounds *bounds, Partial_tour *tour);
+static long mst_bound(Bounds *bounds, Partial_tour *tour);
+static long one_tree_bound(Bounds *bounds, Partial_tour *tour, long limit);
+static long assign_bound(Bounds *bounds, Partial_tour *tour);
+static int find_left(Bounds *bounds, Partial_tour *tour);
+static long exact_bound(Bounds *bounds, Partial_tour *tour, int k);
+static double spanning_tree(Bounds *bounds, int k);
+static int relax(Bounds *bounds, int k, int next);
+static int cheapest_link(Bounds *bounds, Partial_tour *tour, int city, int k);
+static long assignment(Bounds *bounds, int m);
+static void find_enter(Bounds *bounds);
+static long cheapest_enter(Bounds *bounds, int city);
+
+/*--- bound interface --------------------------------------------------------*/
+
+Boolean parse_schedule(const char *spec, Schedule *schedule)
+{
+	int kind;
+	long depth;
+	size_t len;
+	char *end;
+
+	schedule->stages = 0;
+	while (*spec != '\0') {
+		if (schedule->stages == MAX_STAGES) {
+			return FALSE;
+		}
+
+		/* name of the bound */
+		len = strcspn(spec, ":,");
+		for (kind = 0; kind <= BOUND_ASSIGN; kind++) {
+			if (strlen(bound_names[kind]) == len
+					&& strncmp(spec, bound_names[kind], len) == 0) {
+				break;
+			}
+		}
+		if (kind > BOUND_ASSIGN) {
+			return FALSE;
+		}
+		spec += len;
+
+		/* deepest tour it applies to, which only the last stage may leave
+		 * off */
+		depth = INT_MAX;
+		if (*spec == ':') {
+			depth = strtol(spec + 1, &end, 10);
+			if (end == spec + 1 || depth < 1 || depth > INT_MAX) {
+				return FALSE;
+			}
+			spec = end;
+		}
+		if (*spec == ',') {
+			spec++;
+			if (depth == INT_MAX || *spec == '\0') {
+				return FALSE;
+			}
+		} else if (*spec != '\0') {
+			return FALSE;
+		}
+
+		schedule->kind[schedule->stages] = (Bound_kind) kind;
+		schedule->depth[schedule->stages++] = (int) depth;
+	}
+
+	return schedule->stages > 0;
+}
+
+Bounds *bounds_init(Graph *graph, int num_cities, Schedule *schedule)
+{
+	int stage;
+	long rows = num_cities + 1;
+	Boolean assign = FALSE;
+	Bounds *bounds = (Bounds *) malloc(sizeof(Bounds));
+
+	bounds->graph = graph;
+	bounds->kernels = select_kernels();
+	bounds->num_cities = num_cities;
+	bounds->left = (int *) malloc(sizeof(int) * num_cities);
+	bounds->pi = (double *) malloc(sizeof(double) * num_cities);
+	bounds->key = (double *) malloc(sizeof(double) * num_cities);
+	bounds->parent = (int *) malloc(sizeof(int) * num_cities);
+	bounds->degree = (int *) malloc(sizeof(int) * num_cities);
+	bounds->done = (double *) malloc(sizeof(double) * num_cities);
+
+	/* city 0 is never left to visit */
+	bounds->twice = (long *) malloc(sizeof(long) * num_cities);
+	for (int i = 0; i < num_cities; i++) {
+		bounds->twice[i] = (i == 0) ? 0
+			: (long) min_edge(graph, i) + second_min_edge(graph, i);
+	}
+
+	/* a directed tour leaves and enters every city once */
+	bounds->leave = NULL;
+	bounds->enter = NULL;
+	if (graph_directed(graph)) {
+		bounds->leave = (long *) malloc(sizeof(long) * num_cities);
+		bounds->enter = (long *) malloc(sizeof(long) * num_cities);
+		for (int i = 0; i < num_cities; i++) {
+			bounds->leave[i] = min_edge(graph, i);
+		}
+		find_enter(bounds);
+	}
+
+	/* look up the first stage which claims each depth once, rather than on
+	 * every bound */
+	bounds->by_depth = (Bound_kind *) malloc(sizeof(Bound_kind)
+			* (num_cities + 1));
+	for (int depth = 0; depth <= num_cities; depth++) {
+		for (stage = 0; stage < schedule->stages
+				&& schedule->depth[stage] < depth; stage++);
+		bounds->by_depth[depth] = (stage < schedule->stages)
+			? schedule->kind[stage] : BOUND_CHEAP;
+
+		/* trees only bound undirected tours */
+		if (graph_directed(graph) && bounds->by_depth[depth] != BOUND_CHEAP) {
+			bounds->by_depth[depth] = BOUND_ASSIGN;
+		}
+		assign = assign || bounds->by_depth[depth] == BOUND_ASSIGN;
+	}
+
+	/* the assignment problem has a row and a column for every city left to
+	 * visit, and one more for each end of the rest of the tour */
+	bounds->cost = NULL;
+	bounds->row_potential = NULL;
+	bounds->col_potential = NULL;
+	bounds->slack = NULL;
+	bounds->match = NULL;
+	bounds->way = NULL;
+	bounds->used = NULL;
+	if (assign) {
+		bounds->cost = (long *) malloc(sizeof(long) * rows * rows);
+		bounds->row_potential = (long *) malloc(sizeof(long) * rows);
+		bounds->col_potential = (long *) malloc(sizeof(long) * rows);
+		bounds->slack = (long *) malloc(sizeof(long) * rows);
+		bounds->match = (int *) malloc(sizeof(int) * rows);
+		bounds->way = (int *) malloc(sizeof(int) * rows);
+		bounds->used = (Boolean *) malloc(sizeof(Boolean) * rows);
+	}
+
+	return bounds;
+}
+
+int lower_bound(Bounds *bounds, Partial_tour *tour, int limit)
+{
+	long bound, rest = cheap_bound(bounds, tour);
+	int depth = tour_count(tour);
+
+	/* the expensive bounds are only worth it while they can still prune */
+	if (depth > bounds->num_cities || tour_cost(tour) + rest >= limit) {
+		bound = tour_cost(tour) + rest;
+		return (bound < INT_MAX) ? (int) bound : INT_MAX;
+	}
+
+	if (bounds->by_depth[depth] == BOUND_MST) {
+		bound = mst_bound(bounds, tour);
+		rest = (bound > rest) ? bound : rest;
+	} else if (bounds->by_depth[depth] == BOUND_ONE_TREE) {
+		bound = one_tree_bound(bounds, tour, (limit == INT_MAX)
+				? INT_MAX : (long) limit - tour_cost(tour));
+		rest = (bound > rest) ? bound : rest;
+	} else if (bounds->by_depth[depth] == BOUND_ASSIGN) {
+		bound = assign_bound(bounds, tour);
+		rest = (bound > rest) ? bound : rest;
+	}
+
+	bound = tour_cost(tour) + rest;
+	return (bound < INT_MAX) ? (int) bound : INT_MAX;
+}
+
+void bounds_update_edge(Bounds *bounds, int from, int to)
+{
+	Graph *graph = bounds->graph;
+	int ends[2] = {from, to};
+
+	for (int i = 0; i < 2; i++) {
+		if (ends[i] != 0) {
+			bounds->twice[ends[i]] = (long) min_edge(graph, ends[i])
+				+ second_min_edge(graph, ends[i]);
+		}
+	}
+	/* only the arcs leaving from and entering to have changed */
+	if (bounds->leave != NULL) {
+		bounds->leave[from] = min_edge(graph, from);
+		bounds->enter[to] = cheapest_enter(bounds, to);
+	}
+}
+
+void bounds_free(Bounds *bounds)
+{
+	free(bounds->by_depth);
+	free(bounds->twice);
+	free(bounds->leave);
+	free(bounds->enter);
+	free(bounds->left);
+	free(bounds->pi);
+	free(bounds->key);
+	free(bounds->parent);
+	free(bounds->degree);
+	free(bounds->done);
+	free(bounds->cost);
+	free(bounds->row_potential);
+	free(bounds->col_potential);
+	free(bounds->slack);
+	free(bounds->match);
+	free(bounds->way);
+	free(bounds->used);
+	free(bounds);
+}
+
+/*--- bounds -----------------------------------------------------------------*/
+
+/** Every city left to visit is still entered and left along two different
+ * edges, and the last city and city 0 along one each (or two for city 0 if the
+ * tour has just started). Since every edge has two ends, half the sum of the
+ * cheapest edges at each end bounds the cost of the rest of the tour. */
+static long cheap_bound(Bounds *bounds, Partial_tour *tour)
+{
+	Graph *graph = bounds->graph;
+	int last = last_city(tour);
+	long twice, out, in;
+
+	/* in a directed graph, the rest of the tour leaves the last city and
+	 * every city left to visit along one arc each, and enters those cities
+	 * and city 0 along one arc each */
+	if (bounds->leave != NULL) {
+		out = bounds->leave[last] + bounds->kernels->masked_sum(bounds->leave,
+				visited_mask(tour), bounds->num_cities);
+		in = bounds->enter[0] + bounds->kernels->masked_sum(bounds->enter,
+				visited_mask(tour), bounds->num_cities);
+		return (out > in) ? out : in;
+	}
+
+	if (tour_count(tour) == 1) {
+		twice = (long) min_edge(graph, 0) + second_min_edge(graph, 0);
+	} else {
+		twice = (long) min_edge(graph, last) + min_edge(graph, 0);
+	}
+	twice += bounds->kernels->masked_sum(bounds->twice, visited_mask(tour),
+			bounds->num_cities);
+
+	return (twice + 1) / 2;
+}
+
+/** The rest of the tour walks a path through the cities left to visit, which
+ * costs at least as much as their minimum spanning tree, and joins it to the
+ * last city and to city 0 along at least the cheapest edges that could. */
+static long mst_bound(Bounds *bounds, Partial_tour *tour)
+{
+	int k = find_left(bounds, tour), first, back;
+	double tree;
+
+	if (k <= 1) {
+		return exact_bound(bounds, tour, k);
+	}
+
+	for (int i = 0; i < k; i++) {
+		bounds->pi[i] = 0.0;
+	}
+	tree = spanning_tree(bounds, k);
+	first = cheapest_link(bounds, tour, last_city(tour), k);
+	back = cheapest_link(bounds, tour, 0, k);
+	if (tree == HUGE_VAL || first == NO_EDGE || back == NO_EDGE) {
+		return INT_MAX;
+	}
+
+	return (long) tree + first + back;
+}
+
+/** The rest of the tour is a path from the last city through the cities left
+ * to visit and back to city 0. A 1-tree (a spanning tree of the cities left to
+ * visit, plus the cheapest edges joining it to the last city and to city 0, or
+ * the two cheapest joining it to city 0 if the tour has just started) costs no
+ * more than the path. Penalising the edges of every city by how far its
+ * degree in the 1-tree is from 2 (Held and Karp's subgradient optimisation)
+ * pushes the 1-tree towards a cycle and raises the bound. */
+static long one_tree_bound(Bounds *bounds, Partial_tour *tour, long limit)
+{
+	Graph *graph = bounds->graph;
+	int k = find_left(bounds, tour), last = last_city(tour), weight, j1, j2;
+	long norm;
+	double total, c1, c2, best = -HUGE_VAL, step = 2.0, target;
+
+	if (k <= 1) {
+		return exact_bound(bounds, tour, k);
+	}
+
+	for (int i = 0; i < k; i++) {
+		bounds->pi[i] = 0.0;
+	}
+
+	for (int iteration = 0; iteration < ONE_TREE_ITERATIONS; iteration++) {
+		total = spanning_tree(bounds, k);
+		if (total == HUGE_VAL) {
+			return INT_MAX;
+		}
+
+		/* join the tree to the last city and to city 0 along their cheapest
+		 * edges, or to city 0 along its two cheapest if the tour has just
+		 * started */
+		c1 = c2 = HUGE_VAL;
+		j1 = j2 = -1;
+		for (int j = 0; j < k; j++) {
+			weight = edge_weight(graph, last, bounds->left[j]);
+			if (weight != NO_EDGE && weight + bounds->pi[j] < c1) {
+				if (last == 0) {
+					c2 = c1;
+					j2 = j1;
+				}
+				c1 = weight + bounds->pi[j];
+				j1 = j;
+			} else if (last == 0 && weight != NO_EDGE
+					&& weight + bounds->pi[j] < c2) {
+				c2 = weight + bounds->pi[j];
+				j2 = j;
+			}
+			weight = edge_weight(graph, 0, bounds->left[j]);
+			if (last != 0 && weight != NO_EDGE && weight + bounds->pi[j] < c2) {
+				c2 = weight + bounds->pi[j];
+				j2 = j;
+			}
+		}
+		if (j1 < 0 || j2 < 0) {
+			return INT_MAX;
+		}
+		total += c1 + c2;
+		bounds->degree[j1]++;
+		bounds->degree[j2]++;
+		for (int i = 0; i < k; i++) {
+			total -= 2.0 * bounds->pi[i];
+		}
+		if (total > best) {
+			best = total;
+		}
+
+		/* stop once the tour will be pruned, or the 1-tree is a cycle */
+		if (ceil(best - EPSILON) >= limit) {
+			break;
+		}
+		norm = 0;
+		for (int i = 0; i < k; i++) {
+			norm += (long) (bounds->degree[i] - 2) * (bounds->degree[i] - 2);
+		}
+		if (norm == 0) {
+			break;
+		}
+
+		/* step towards the incumbent, or a little past the bound if there is
+		 * none yet */
+		target = (limit < INT_MAX) ? (double) limit : 1.05 * fabs(best) + 1.0;
+		for (int i = 0; i < k; i++) {
+			bounds->pi[i] += step * (target - total) / norm
+				* (bounds->degree[i] - 2);
+		}
+		step *= STEP_DECAY;
+	}
+
+	return (long) ceil(best - EPSILON);
+}
+
+/** The rest of the tour leaves the last city and every city left to visit for
+ * a different one of the cities left to visit or city 0, so it costs at least
+ * as much as the cheapest way of assigning each of them a different next city.
+ * Unlike the trees, this holds whichever way round the edges may be walked. */
+static long assign_bound(Bounds *bounds, Partial_tour *tour)
+{
+	Graph *graph = bounds->graph;
+	int k = find_left(bounds, tour), last = last_city(tour), m = k + 1;
+	int from, to, weight;
+
+	if (k <= 1) {
+		return exact_bound(bounds, tour, k);
+	}
+
+	/* row 1 is the last city and rows 2 to m the cities left to visit, which
+	 * are also columns 1 to k, and column m is city 0. A city can not follow
+	 * itself, and the last city can only go straight back to city 0 once
+	 * there is nothing left to visit. */
+	for (int i = 1; i <= m; i++) {
+		from = (i == 1) ? last : bounds->left[i - 2];
+		for (int j = 1; j <= m; j++) {
+			to = (j == m) ? 0 : bounds->left[j - 1];
+			weight = (from == to || (i == 1 && j == m)) ? NO_EDGE
+				: edge_weight(graph, from, to);
+			bounds->cost[(long) (i - 1) * m + j - 1] = weight;
+		}
+	}
+
+	return assignment(bounds, m);
+}
+
+/*--- utility functions ------------------------------------------------------*/
+
+/** Collect the cities the tour has left to visit, and return how many there
+ * are */
+static int find_left(Bounds *bounds, Partial_tour *tour)
+{
+	int k = 0;
+	for (int i = 1; i < bounds->num_cities; i++) {
+		if (!visited(tour, i)) {
+			bounds->left[k++] = i;
+		}
+	}
+	return k;
+}
+
+/** Return the exact cost of the rest of the tour when at most one city is left
+ * to visit, or INT_MAX if it cannot be finished */
+static long exact_bound(Bounds *bounds, Partial_tour *tour, int k)
+{
+	Graph *graph = bounds->graph;
+	int last = last_city(tour), to, from;
+
+	if (k == 0) {
+		to = edge_weight(graph, last, 0);
+		return (to == NO_EDGE) ? INT_MAX : to;
+	}
+	to = edge_weight(graph, last, bounds->left[0]);
+	from = edge_weight(graph, bounds->left[0], 0);
+	if (to == NO_EDGE || from == NO_EDGE) {
+		return INT_MAX;
+	}
+	return (long) to + from;
+}
+
+/** Build a minimum spanning tree over the k cities left to visit with Prim's
+ * algorithm, with every edge penalised by pi at both ends. Return its cost and
+ * record the degree of every city in it, or HUGE_VAL if the cities are not
+ * connected. */
+static double spanning_tree(Bounds *bounds, int k)
+{
+	int next = 0;
+	double total = 0.0;
+	const int *row;
+
+	for (int i = 0; i < k; i++) {
+		bounds->key[i] = HUGE_VAL;
+		bounds->parent[i] = -1;
+		bounds->degree[i] = 0;
+		bounds->done[i] = 0.0;
+	}
+	bounds->key[0] = 0.0;
+
+	for (int added = 0; added < k; added++) {
+		/* add the city closest to the tree */
+		if (next < 0) {
+			return HUGE_VAL;
+		}
+		bounds->done[next] = HUGE_VAL;
+		total += bounds->key[next];
+		if (bounds->parent[next] >= 0) {
+			bounds->degree[next]++;
+			bounds->degree[bounds->parent[next]]++;
+		}
+
+		/* see if it is closer to the cities still outside the tree, and find
+		 * the one closest to the tree now, a whole row at a time if the graph
+		 * is a matrix */
+		row = graph_row(bounds->graph, bounds->left[next]);
+		if (row != NULL) {
+			next = bounds->kernels->prim_step(row, bounds->left, k, next,
+					bounds->pi, bounds->done, bounds->key, bounds->parent);
+		} else {
+			next = relax(bounds, k, next);
+		}
+	}
+
+	return total;
+}
+
+/** The step of Prim's algorithm which prim_step carries out for a matrix, for
+ * graphs stored as sparse rows instead */
+static int relax(Bounds *bounds, int k, int next)
+{
+	int weight, best = -1;
+	double cost;
+
+	for (int i = 0; i < k; i++) {
+		if (bounds->done[i] != 0.0) {
+			continue;
+		}
+		weight = edge_weight(bounds->graph, bounds->left[next],
+				bounds->left[i]);
+		if (weight != NO_EDGE) {
+			cost = weight + bounds->pi[next] + bounds->pi[i];
+			if (cost < bounds->key[i]) {
+				bounds->key[i] = cost;
+				bounds->parent[i] = next;
+			}
+		}
+		if (bounds->key[i] < HUGE_VAL
+				&& (best < 0 || bounds->key[i] < bounds->key[best])) {
+			best = i;
+		}
+	}
+
+	return best;
+}
+
+/** Return the weight of the cheapest edge from city to one of the k cities left
+ * to visit, or NO_EDGE if there is none */
+static int cheapest_link(Bounds *bounds, Partial_tour *tour, int city, int k)
+{
+	int weight, best = NO_EDGE;
+	const int *row = graph_row(bounds->graph, city);
+
+	if (row != NULL) {
+		return bounds->kernels->masked_min(row, visited_mask(tour),
+				bounds->num_cities);
+	}
+	for (int i = 0; i < k; i++) {
+		weight = edge_weight(bounds->graph, city, bounds->left[i]);
+		if (weight < best) {
+			best = weight;
+		}
+	}
+	return best;
+}
+
+/** Solve the m by m assignment problem in cost with the Hungarian method,
+ * adding one row at a time and finding the cheapest way of making room for it
+ * along a path of reduced costs. Return the cost of the cheapest assignment,
+ * or INT_MAX if every assignment uses a missing arc. */
+static long assignment(Bounds *bounds, int m)
+{
+	long *cost = bounds->cost, *u = bounds->row_potential;
+	long *v = bounds->col_potential, *slack = bounds->slack;
+	long delta, reduced, total = 0;
+	int *match = bounds->match, *way = bounds->way, row, col, next = 0;
+	Boolean *used = bounds->used;
+
+	for (int j = 0; j <= m; j++) {
+		u[j] = 0;
+		v[j] = 0;
+		match[j] = 0;
+	}
+	for (int i = 1; i <= m; i++) {
+		/* grow a tree of tight edges from row i until it reaches a free
+		 * column, using column 0 to stand for row i itself */
+		match[0] = i;
+		col = 0;
+		for (int j = 0; j <= m; j++) {
+			slack[j] = LONG_MAX;
+			used[j] = FALSE;
+		}
+		do {
+			used[col] = TRUE;
+			row = match[col];
+			delta = LONG_MAX;
+			for (int j = 1; j <= m; j++) {
+				if (used[j]) {
+					continue;
+				}
+				reduced = cost[(long) (row - 1) * m + j - 1] - u[row] - v[j];
+				if (reduced < slack[j]) {
+					slack[j] = reduced;
+					way[j] = col;
+				}
+				if (slack[j] < delta) {
+					delta = slack[j];
+					next = j;
+				}
+			}
+			for (int j = 0; j <= m; j++) {
+				if (used[j]) {
+					u[match[j]] += delta;
+					v[j] -= delta;
+				} else {
+					slack[j] -= delta;
+				}
+			}
+			col = next;
+		} while (match[col] != 0);
+
+		/* flip the assignments along the path back to row i */
+		do {
+			next = way[col];
+			match[col] = match[next];
+			col = next;
+		} while (col != 0);
+	}
+
+	for (int j = 1; j <= m; j++) {
+		if (cost[(long) (match[j] - 1) * m + j - 1] == NO_EDGE) {
+			return INT_MAX;
+		}
+		total += cost[(long) (match[j] - 1) * m + j - 1];
+	}
+	return total;
+}
+
+/** Record the cheapest arc entering every city of a directed graph, or 0 if
+ * there is none */
+static void find_enter(Bounds *bounds)
+{
+	int city, neighbour, cost;
+	Adj_iter iter;
+	Boolean found;
+
+	for (int i = 0; i < bounds->num_cities; i++) {
+		bounds->enter[i] = NO_EDGE;
+	}
+	for (int i = 0; i < bounds->num_cities; i++) {
+		city = i;
+		found = adj(bounds->graph, &iter, &city, &neighbour, &cost);
+		while (found) {
+			if (cost < bounds->enter[neighbour]) {
+				bounds->enter[neighbour] = cost;
+			}
+			found = adj(bounds->graph, &iter, NULL, &neighbour, &cost);
+		}
+	}
+	for (int i = 0; i < bounds->num_cities; i++) {
+		if (bounds->enter[i] == NO_EDGE) {
+			bounds->enter[i] = 0;
+		}
+	}
+}
+
+/** Return the weight of the cheapest arc entering a city, or 0 if there is
+ * none, by looking it up from every other city */
+static long cheapest_enter(Bounds *bounds, int city)
+{
+	int weight, best = NO_EDGE;
+
+	for (int i = 0; i < bounds->num_cities; i++) {
+		weight = (i == city) ? NO_EDGE : edge_weight(bounds->graph, i, city);
+		best = (weight < best) ? weight : best;
+	}
+	return (best == NO_EDGE) ? 0 : best;
+}
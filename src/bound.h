@@ -0,0 +1,119 @@
+/**
+ * @file    bound.h
+ * @brief   Lower bounds on the cost of completing a partial tour, which the
+ *          branch and bound search prunes with.
+ * @author  L. Foxcroft
+ * @date    2022-06-16
+ */
+
+#ifndef BOUND_H
+#define BOUND_H
+
+#include "boolean.h"
+#include "graph.h"
+#include "stack.h"
+
+/** the most stages a bound schedule can be made up of */
+#define MAX_STAGES 8
+
+/** the lower bounds which can be used to prune a partial tour */
+typedef enum bound_kind {
+	/** half the two cheapest edges of every city left to visit */
+	BOUND_CHEAP,
+	/** a minimum spanning tree over the cities left to visit */
+	BOUND_MST,
+	/** a Held-Karp 1-tree, tightened with subgradient optimisation */
+	BOUND_ONE_TREE,
+	/** the cheapest assignment of a next city to every city, which is the
+	 * only one of the expensive bounds that holds for directed graphs */
+	BOUND_ASSIGN
+} Bound_kind;
+
+/** which bound to use at each depth of the search. Stage i applies to partial
+ * tours of at most depth[i] cities, which have not been claimed by an earlier
+ * stage, and deeper tours fall back on BOUND_CHEAP. Directed graphs use
+ * BOUND_ASSIGN in place of BOUND_MST and BOUND_ONE_TREE. */
+typedef struct schedule {
+	/** the number of stages */
+	int stages;
+	/** the bound used by each stage */
+	Bound_kind kind[MAX_STAGES];
+	/** the deepest partial tour each stage applies to */
+	int depth[MAX_STAGES];
+} Schedule;
+
+/** the container structure for the scratch space used to compute bounds */
+typedef struct bounds Bounds;
+
+/*--- function prototypes ----------------------------------------------------*/
+
+/**
+ * Parses a bound schedule from a comma separated list of stages of the form
+ * kind:depth, where kind is one of cheap, mst, 1tree or assign. The depth may
+ * be left off the last stage, in which case it applies to every deeper tour.
+ * For example, "1tree:4,mst:10" uses the 1-tree bound for tours of up to 4
+ * cities, the spanning tree bound for up to 10, and the cheap bound beyond
+ * that.
+ *
+ * @param[in]   spec
+ *     the schedule to parse
+ * @param[out]  schedule
+ *     the parsed schedule
+ * @return      true if spec was a valid schedule, else false
+ */
+Boolean parse_schedule(const char *spec, Schedule *schedule);
+
+/**
+ * Allocates the scratch space for computing bounds on the partial tours of a
+ * graph. Each thread should have its own.
+ *
+ * @param[in]   graph
+ *     a pointer to the graph being searched
+ * @param[in]   num_cities
+ *     the number of cities in the graph
+ * @param[in]   schedule
+ *     which bound to use at each depth, which is copied
+ * @return      a pointer to the scratch space
+ */
+Bounds *bounds_init(Graph *graph, int num_cities, Schedule *schedule);
+
+/**
+ * Returns an admissible lower bound on the cost of any complete tour which
+ * extends the specified partial tour, computed with the bound that the
+ * schedule picks for its depth. The more expensive bounds give up as soon as
+ * they reach limit, since the tour will be pruned anyway.
+ *
+ * @param[in]   bounds
+ *     the scratch space of the calling thread
+ * @param[in]   tour
+ *     the partial tour to bound
+ * @param[in]   limit
+ *     the cost of the best tour found so far
+ * @return      the lower bound, or INT_MAX if the tour cannot be completed
+ */
+int lower_bound(Bounds *bounds, Partial_tour *tour, int limit);
+
+/**
+ * Brings the per-city bounds cached in the scratch space up to date after
+ * set_edge_weight has changed the edge from one city to another, so that the
+ * scratch space can be kept for the next search of the same graph. Only the
+ * cities at the ends of the edge are looked at again.
+ *
+ * @param[in]   bounds
+ *     the scratch space of one thread
+ * @param[in]   from
+ *     the city the changed edge starts at
+ * @param[in]   to
+ *     the city the changed edge ends at
+ */
+void bounds_update_edge(Bounds *bounds, int from, int to);
+
+/**
+ * Frees the scratch space used to compute bounds.
+ *
+ * @param[in]   bounds
+ *     the scratch space to free
+ */
+void bounds_free(Bounds *bounds);
+
+#endif /* BOUND_H */
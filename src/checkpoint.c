@@ -0,0 +1,336 @@
+/**
+ * @file    checkpoint.c
+ * @brief   Checkpoint files holding a process's frontier of partial tours and
+ *          its best tour, written by a background thread.
+ * @author  L. Foxcroft
+ * @date    2022-06-19
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <mpi.h>
+#include "checkpoint.h"
+
+/* the first two ints of every checkpoint file */
+#define MAGIC   0x43505354 /* "TSPC" */
+#define VERSION 2
+/* the number of ints in the header: magic, version, cities, rank, processes,
+ * and the low and high halves of the graph's fingerprint */
+#define HEADER_SIZE 7
+
+/** a checkpointer container */
+struct checkpointer {
+	/** the name of this process's checkpoint file */
+	char *path;
+	/** the name the checkpoint is written to before it replaces the last */
+	char *temp;
+	/** the number of seconds between checkpoints */
+	double interval;
+	/** the time at which the next checkpoint is due */
+	double next;
+	/** the number of cities in the graph being searched */
+	int num_cities;
+	/** a fingerprint of the weights of the graph being searched */
+	uint64_t fingerprint;
+	/** rank of this process */
+	int rank;
+	/** number of processes */
+	int size;
+	/** the packed checkpoint being written */
+	int *buffer;
+	/** the number of ints in buffer */
+	long length;
+	/** the thread writing the last checkpoint */
+	pthread_t writer;
+	/** whether writer has been started and not yet joined */
+	Boolean started;
+	/** set while the writer is busy */
+	atomic_int busy;
+};
+
+/*--- function prototypes ----------------------------------------------------*/
+
+static void *write_file(void *arg);
+static int *read_file(const char *path, long *length);
+static void join_writer(Checkpointer *checkpointer);
+static char *file_name(const char *prefix, int rank, const char *suffix);
+static uint64_t fingerprint(Graph *graph, int num_cities);
+static Partial_tour *recost(Graph *graph, Partial_tour *tour, int num_cities);
+
+/*--- checkpoint interface ---------------------------------------------------*/
+
+Checkpointer *checkpoint_init(const char *prefix, double interval,
+		Graph *graph, int num_cities)
+{
+	Checkpointer *checkpointer = (Checkpointer *) malloc(sizeof(Checkpointer));
+
+	MPI_Comm_rank(MPI_COMM_WORLD, &checkpointer->rank);
+	MPI_Comm_size(MPI_COMM_WORLD, &checkpointer->size);
+	checkpointer->path = file_name(prefix, checkpointer->rank, "");
+	checkpointer->temp = file_name(prefix, checkpointer->rank, ".tmp");
+	checkpointer->interval = interval;
+	checkpointer->next = MPI_Wtime() + interval;
+	checkpointer->num_cities = num_cities;
+	checkpointer->fingerprint = fingerprint(graph, num_cities);
+	checkpointer->buffer = NULL;
+	checkpointer->length = 0;
+	checkpointer->started = FALSE;
+	atomic_init(&checkpointer->busy, 0);
+
+	return checkpointer;
+}
+
+Boolean checkpoint_due(Checkpointer *checkpointer)
+{
+	return checkpoint_ready(checkpointer) && MPI_Wtime() >= checkpointer->next;
+}
+
+Boolean checkpoint_ready(Checkpointer *checkpointer)
+{
+	return !atomic_load(&checkpointer->busy);
+}
+
+void checkpoint_write(Checkpointer *checkpointer, Stack *frontier,
+		Partial_tour *best, Boolean wait)
+{
+	int *buffer;
+	long position = 0;
+	Stack *single;
+
+	join_writer(checkpointer);
+
+	/* the header, then the best tour and the frontier, each packed as a stack
+	 * and preceded by its length */
+	single = stack_init(checkpointer->num_cities);
+	push_copy(single, best);
+	buffer = (int *) malloc(sizeof(int) * (HEADER_SIZE + 2
+				+ packed_size(single) + packed_size(frontier)));
+	buffer[position++] = MAGIC;
+	buffer[position++] = VERSION;
+	buffer[position++] = checkpointer->num_cities;
+	buffer[position++] = checkpointer->rank;
+	buffer[position++] = checkpointer->size;
+	buffer[position++] = (int) (uint32_t) checkpointer->fingerprint;
+	buffer[position++] = (int) (uint32_t) (checkpointer->fingerprint >> 32);
+	buffer[position++] = packed_size(single);
+	position += pack_stack(single, buffer + position);
+	buffer[position++] = packed_size(frontier);
+	position += pack_stack(frontier, buffer + position);
+	free_stack(single);
+
+	checkpointer->buffer = buffer;
+	checkpointer->length = position;
+	checkpointer->next = MPI_Wtime() + checkpointer->interval;
+	atomic_store(&checkpointer->busy, 1);
+	if (wait) {
+		write_file(checkpointer);
+	} else {
+		pthread_create(&checkpointer->writer, NULL, write_file, checkpointer);
+		checkpointer->started = TRUE;
+	}
+}
+
+Boolean checkpoint_resume(const char *prefix, Graph *graph, int num_cities,
+		Stack *frontier, Partial_tour *best)
+{
+	int size = 1, *buffer, length;
+	long file_length, position;
+	uint64_t expected = fingerprint(graph, num_cities);
+	char *path;
+	Boolean ok = TRUE;
+	Stack *single = stack_init(num_cities), *saved = stack_init(num_cities);
+	Partial_tour *tour = tour_init(num_cities), *copy;
+
+	/* the first file says how many processes wrote checkpoints */
+	for (int rank = 0; ok && rank < size; rank++) {
+		path = file_name(prefix, rank, "");
+		buffer = read_file(path, &file_length);
+		ok = buffer != NULL && file_length >= HEADER_SIZE + 1
+			&& buffer[0] == MAGIC && buffer[1] == VERSION
+			&& buffer[2] == num_cities && buffer[3] == rank && buffer[4] > 0
+			&& (rank == 0 || buffer[4] == size)
+			&& (uint32_t) buffer[5] == (uint32_t) expected
+			&& (uint32_t) buffer[6] == (uint32_t) (expected >> 32);
+		if (ok) {
+			size = buffer[4];
+			position = HEADER_SIZE;
+			length = buffer[position++];
+			ok = length >= 0 && position + length < file_length;
+		}
+		if (ok) {
+			ok = unpack_stack(single, buffer + position, length)
+				&& stack_size(single) == 1;
+			position += length;
+			length = buffer[position++];
+			ok = ok && length >= 0 && position + length == file_length;
+		}
+		if (ok) {
+			/* the saved best tour has no cities after city 0 if none was
+			 * found, and otherwise must be a whole tour of this graph */
+			pop(single, tour);
+			if (tour_count(tour) > 1) {
+				copy = (tour_count(tour) == num_cities + 1)
+					? recost(graph, tour, num_cities) : NULL;
+				ok = copy != NULL;
+				if (ok) {
+					if (tour_cost(copy) < tour_cost(best)) {
+						copy_tour(best, copy);
+					}
+					free_tour(copy);
+				}
+			}
+		}
+		if (ok) {
+			/* the costs in the file are not trusted, so every tour left to
+			 * search is costed again over the edges of this graph */
+			ok = unpack_stack(saved, buffer + position, length);
+			while (stack_size(saved) > 0) {
+				pop_front(saved, tour);
+				copy = ok ? recost(graph, tour, num_cities) : NULL;
+				ok = copy != NULL;
+				if (ok) {
+					push_copy(frontier, copy);
+					free_tour(copy);
+				}
+			}
+		}
+		free(buffer);
+		free(path);
+	}
+
+	free_stack(single);
+	free_stack(saved);
+	free_tour(tour);
+
+	return ok;
+}
+
+void checkpoint_free(Checkpointer *checkpointer)
+{
+	join_writer(checkpointer);
+	free(checkpointer->path);
+	free(checkpointer->temp);
+	free(checkpointer);
+}
+
+/*--- utility functions ------------------------------------------------------*/
+
+/** Write the packed checkpoint to a temporary file and move it over the last
+ * checkpoint, so that a process killed part way through leaves the last one
+ * whole. Runs on the writer thread unless the caller is waiting for it. */
+static void *write_file(void *arg)
+{
+	Checkpointer *checkpointer = (Checkpointer *) arg;
+	FILE *file = fopen(checkpointer->temp, "wb");
+
+	if (file == NULL
+			|| fwrite(checkpointer->buffer, sizeof(int), checkpointer->length,
+				file) != (size_t) checkpointer->length
+			|| fclose(file) != 0
+			|| rename(checkpointer->temp, checkpointer->path) != 0) {
+		perror("checkpoint");
+	}
+
+	free(checkpointer->buffer);
+	checkpointer->buffer = NULL;
+	atomic_store(&checkpointer->busy, 0);
+
+	return NULL;
+}
+
+/** Read a whole checkpoint file into a buffer of ints, returning NULL if it
+ * could not be read */
+static int *read_file(const char *path, long *length)
+{
+	FILE *file = fopen(path, "rb");
+	long bytes;
+	int *buffer;
+
+	if (file == NULL) {
+		return NULL;
+	}
+	fseek(file, 0, SEEK_END);
+	bytes = ftell(file);
+	rewind(file);
+	*length = bytes / (long) sizeof(int);
+	buffer = (int *) malloc(sizeof(int) * (*length > 0 ? *length : 1));
+	if (bytes < 0 || fread(buffer, sizeof(int), *length, file)
+			!= (size_t) *length) {
+		free(buffer);
+		buffer = NULL;
+	}
+	fclose(file);
+
+	return buffer;
+}
+
+/** Wait for the writer thread to finish the last checkpoint, if there is one */
+static void join_writer(Checkpointer *checkpointer)
+{
+	if (checkpointer->started) {
+		pthread_join(checkpointer->writer, NULL);
+		checkpointer->started = FALSE;
+	}
+}
+
+/** Return the name of a process's checkpoint file, with suffix on the end */
+static char *file_name(const char *prefix, int rank, const char *suffix)
+{
+	size_t size = strlen(prefix) + strlen(suffix) + 16;
+	char *name = (char *) malloc(size);
+
+	snprintf(name, size, "%s.%d%s", prefix, rank, suffix);
+	return name;
+}
+
+/** Return a fingerprint of the weights of a graph, so that a checkpoint is
+ * only resumed against the graph it was taken of. Each edge is mixed on its
+ * own and the results added up, so the order neighbours are listed in does not
+ * matter. */
+static uint64_t fingerprint(Graph *graph, int num_cities)
+{
+	int degree;
+	const int *neighbours, *costs;
+	uint64_t sum = (uint64_t) num_cities, x;
+
+	for (int city = 0; city < num_cities; city++) {
+		degree = neighbours_by_cost(graph, city, &neighbours, &costs);
+		for (int i = 0; i < degree; i++) {
+			/* the splitmix64 finaliser */
+			x = ((uint64_t) city << 32 | (uint32_t) neighbours[i])
+				^ (uint64_t) (uint32_t) costs[i] * 0x9E3779B97F4A7C15ULL;
+			x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+			x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+			sum += x ^ (x >> 31);
+		}
+	}
+
+	return sum;
+}
+
+/** Return a copy of a tour which starts from city 0, costed over the edges of
+ * the graph, or NULL if its route takes an edge which the graph does not
+ * have */
+static Partial_tour *recost(Graph *graph, Partial_tour *tour, int num_cities)
+{
+	int from, to, weight;
+	Partial_tour *copy = tour_init(num_cities);
+
+	add_city(copy, 0, 0);
+	for (int i = 1; i < tour_count(tour); i++) {
+		from = tour_city(tour, i - 1);
+		to = tour_city(tour, i);
+		weight = edge_weight(graph, from, to);
+		if (weight == NO_EDGE) {
+			free_tour(copy);
+			return NULL;
+		}
+		add_city(copy, to, weight);
+	}
+
+	return copy;
+}
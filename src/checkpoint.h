@@ -0,0 +1,119 @@
+/**
+ * @file    checkpoint.h
+ * @brief   Periodic checkpoints of the branch and bound search, written in the
+ *          background, so that a search which is killed can be restarted.
+ * @author  L. Foxcroft
+ * @date    2022-06-19
+ */
+
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include "boolean.h"
+#include "graph.h"
+#include "stack.h"
+
+/** the container structure for a process's checkpoints */
+typedef struct checkpointer Checkpointer;
+
+/*--- function prototypes ----------------------------------------------------*/
+
+/**
+ * Sets up checkpoints for this process, which are written to the file named
+ * by prefix followed by a dot and the rank of the process, replacing the last
+ * checkpoint only once the new one is complete. Each checkpoint records a
+ * fingerprint of the graph's weights, so it can only be resumed against the
+ * same graph.
+ *
+ * @param[in]   prefix
+ *     the start of the name of every process's checkpoint file
+ * @param[in]   interval
+ *     the number of seconds between checkpoints
+ * @param[in]   graph
+ *     a pointer to the graph being searched
+ * @param[in]   num_cities
+ *     the number of cities in the graph being searched
+ * @return      a pointer to the checkpointer
+ */
+Checkpointer *checkpoint_init(const char *prefix, double interval,
+		Graph *graph, int num_cities);
+
+/**
+ * Returns whether it is time for the next checkpoint, which it is not while
+ * the last one is still being written. Only the thread which makes MPI calls
+ * may call this.
+ *
+ * @param[in]   checkpointer
+ *     a pointer to the checkpointer
+ * @return      true if a checkpoint should be written, else false
+ */
+Boolean checkpoint_due(Checkpointer *checkpointer);
+
+/**
+ * Returns whether the last checkpoint has been written, so that another can be
+ * taken without waiting for it. Only the thread which makes MPI calls may call
+ * this.
+ *
+ * @param[in]   checkpointer
+ *     a pointer to the checkpointer
+ * @return      true if no checkpoint is being written, else false
+ */
+Boolean checkpoint_ready(Checkpointer *checkpointer);
+
+/**
+ * Packs the partial tours this process has left to search and the best tour it
+ * knows of into a compact binary buffer, and writes it to the checkpoint file
+ * on a separate thread, so that the search can carry on at once. The frontier
+ * is left empty, and both it and the tour may be reused as soon as this
+ * returns.
+ *
+ * @param[in]   checkpointer
+ *     a pointer to the checkpointer
+ * @param[in,out] frontier
+ *     every partial tour this process has yet to search
+ * @param[in]   best
+ *     the best tour this process knows of, which may have a cost of INT_MAX
+ * @param[in]   wait
+ *     whether to wait until the checkpoint has been written, such as for the
+ *     last checkpoint of a search
+ */
+void checkpoint_write(Checkpointer *checkpointer, Stack *frontier,
+		Partial_tour *best, Boolean wait);
+
+/**
+ * Reads every process's checkpoint file from a run which may have had any
+ * number of processes, pushing all of the partial tours they had left to
+ * search onto frontier, and copying the best tour any of them knew of into
+ * best if it is cheaper. Tours may appear in more than one file, since work
+ * sent between processes is saved by both ends. The cost of every saved tour is
+ * worked out again from the graph rather than read from the file.
+ *
+ * @param[in]     prefix
+ *     the start of the name of every process's checkpoint file
+ * @param[in]     graph
+ *     a pointer to the graph being searched, whose weights must match the
+ *     fingerprint in every file
+ * @param[in]     num_cities
+ *     the number of cities in the graph being searched, which must match the
+ *     run that wrote the checkpoints
+ * @param[in,out] frontier
+ *     the stack the saved partial tours are pushed onto
+ * @param[in,out] best
+ *     the best tour known so far, which is replaced by a cheaper saved tour
+ * @return        true if every file was read, or false if one was missing or
+ *                did not match the graph, or held a tour which could not
+ *                be a tour of it or took an edge it does not have
+ */
+Boolean checkpoint_resume(const char *prefix, Graph *graph, int num_cities,
+		Stack *frontier, Partial_tour *best);
+
+/**
+ * Waits for the last checkpoint to be written, and frees the space associated
+ * with the checkpointer.
+ *
+ * @param[in]   checkpointer
+ *     the checkpointer to free
+ */
+void checkpoint_free(Checkpointer *checkpointer);
+
+#endif /* CHECKPOINT_H */
@@ -0,0 +1,125 @@
+/**
+ * @file    deque.c
+ * @brief   A fixed capacity Chase-Lev work stealing deque, following the C11
+ *          formulation by Le, Pop, Cohen and Zappa Nardelli (2013).
+ * @author  L. Foxcroft
+ * @date    2022-06-12
+ */
+
+#include <stdlib.h>
+#include <stdatomic.h>
+#include "deque.h"
+
+/** a work stealing deque container */
+struct deque {
+	/** index of the next tour to be stolen */
+	atomic_long top;
+	/** index one past the tour the owner works on next */
+	atomic_long bottom;
+	/** number of slots in the circular buffer */
+	long capacity;
+	/** circular buffer of tours */
+	_Atomic(Partial_tour *) *tours;
+};
+
+/*--- deque interface --------------------------------------------------------*/
+
+Deque *deque_init(int capacity)
+{
+	Deque *deque = (Deque *) malloc(sizeof(Deque));
+
+	atomic_init(&deque->top, 0);
+	atomic_init(&deque->bottom, 0);
+	deque->capacity = capacity;
+	deque->tours = malloc(sizeof(Partial_tour *) * capacity);
+	for (int i = 0; i < capacity; i++) {
+		atomic_init(&deque->tours[i], NULL);
+	}
+
+	return deque;
+}
+
+int deque_size(Deque *deque)
+{
+	long b = atomic_load_explicit(&deque->bottom, memory_order_relaxed);
+	long t = atomic_load_explicit(&deque->top, memory_order_relaxed);
+	return (b > t) ? (int) (b - t) : 0;
+}
+
+Boolean deque_push(Deque *deque, Partial_tour *tour)
+{
+	long b = atomic_load_explicit(&deque->bottom, memory_order_relaxed);
+	long t = atomic_load_explicit(&deque->top, memory_order_acquire);
+
+	if (b - t >= deque->capacity) {
+		return FALSE;
+	}
+
+	atomic_store_explicit(&deque->tours[b % deque->capacity], tour,
+			memory_order_relaxed);
+	atomic_thread_fence(memory_order_release);
+	atomic_store_explicit(&deque->bottom, b + 1, memory_order_relaxed);
+
+	return TRUE;
+}
+
+Partial_tour *deque_pop(Deque *deque)
+{
+	long b = atomic_load_explicit(&deque->bottom, memory_order_relaxed) - 1;
+	long t;
+	Partial_tour *tour = NULL;
+
+	/* claim the bottom slot before looking at what thieves have taken */
+	atomic_store_explicit(&deque->bottom, b, memory_order_relaxed);
+	atomic_thread_fence(memory_order_seq_cst);
+	t = atomic_load_explicit(&deque->top, memory_order_relaxed);
+
+	if (t <= b) {
+		tour = atomic_load_explicit(&deque->tours[b % deque->capacity],
+				memory_order_relaxed);
+		if (t == b) {
+			/* last tour, so race any thieves for it */
+			if (!atomic_compare_exchange_strong_explicit(&deque->top, &t,
+						t + 1, memory_order_seq_cst, memory_order_relaxed)) {
+				tour = NULL;
+			}
+			atomic_store_explicit(&deque->bottom, b + 1, memory_order_relaxed);
+		}
+	} else {
+		atomic_store_explicit(&deque->bottom, b + 1, memory_order_relaxed);
+	}
+
+	return tour;
+}
+
+Partial_tour *deque_steal(Deque *deque)
+{
+	long t = atomic_load_explicit(&deque->top, memory_order_acquire);
+	long b;
+	Partial_tour *tour = NULL;
+
+	atomic_thread_fence(memory_order_seq_cst);
+	b = atomic_load_explicit(&deque->bottom, memory_order_acquire);
+
+	if (t < b) {
+		tour = atomic_load_explicit(&deque->tours[t % deque->capacity],
+				memory_order_relaxed);
+		if (!atomic_compare_exchange_strong_explicit(&deque->top, &t, t + 1,
+					memory_order_seq_cst, memory_order_relaxed)) {
+			return NULL;
+		}
+	}
+
+	return tour;
+}
+
+void free_deque(Deque *deque)
+{
+	Partial_tour *tour;
+
+	while ((tour = deque_pop(deque)) != NULL) {
+		free_tour(tour);
+	}
+	free(deque->tours);
+	free(deque);
+}
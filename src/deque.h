@@ -0,0 +1,80 @@
+/**
+ * @file    deque.h
+ * @brief   A lock-free work stealing deque of partial tours.
+ * @author  L. Foxcroft
+ * @date    2022-06-12
+ */
+
+#ifndef DEQUE_H
+#define DEQUE_H
+
+#include "boolean.h"
+#include "stack.h"
+
+/** the container structure for a work stealing deque */
+typedef struct deque Deque;
+
+/*--- function prototypes ----------------------------------------------------*/
+
+/**
+ * Allocates a deque which can hold up to capacity partial tours at once. One
+ * thread owns the deque and works at its bottom, while any other thread may
+ * steal from its top.
+ *
+ * @param[in]   capacity
+ *     the maximum number of tours on the deque
+ * @return      a pointer to the deque
+ */
+Deque *deque_init(int capacity);
+
+/**
+ * Returns roughly how many tours are on the deque. This is only a snapshot when
+ * other threads are stealing from it.
+ *
+ * @param[in]   deque
+ *     a pointer to the deque
+ * @return      the number of tours on the deque
+ */
+int deque_size(Deque *deque);
+
+/**
+ * Adds a tour to the bottom of the deque. Only the owner may call this. The
+ * deque takes over the tour, which should have been allocated with tour_init.
+ *
+ * @param[in]   deque
+ *     a pointer to the deque
+ * @param[in]   tour
+ *     the tour to add
+ * @return      true if the tour was added, or false if the deque is full
+ */
+Boolean deque_push(Deque *deque, Partial_tour *tour);
+
+/**
+ * Removes the tour at the bottom of the deque. Only the owner may call this.
+ *
+ * @param[in]   deque
+ *     a pointer to the deque
+ * @return      the tour, which the caller should free, or NULL if the deque is
+ *              empty
+ */
+Partial_tour *deque_pop(Deque *deque);
+
+/**
+ * Removes the tour at the top of the deque. Any thread may call this.
+ *
+ * @param[in]   deque
+ *     a pointer to the deque
+ * @return      the tour, which the caller should free, or NULL if the deque is
+ *              empty or another thread took the tour first
+ */
+Partial_tour *deque_steal(Deque *deque);
+
+/**
+ * Frees the space associated with the deque and any tours still on it.
+ *
+ * @param[in]   deque
+ *     the deque to free
+ */
+void free_deque(Deque *deque);
+
+#endif /* DEQUE_H */
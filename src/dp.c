@@ -0,0 +1,357 @@
+/**
+ * @file    dp.c
+ * @brief   Held-Karp dynamic programming, computed one layer of subsets at a
+ *          time and split between processes and threads.
+ * @author  L. Foxcroft
+ * @date    2022-06-15
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <limits.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <mpi.h>
+#include "dp.h"
+
+/* cost of a path which doesn't exist */
+#define INFINITE INT_MAX
+
+/** a container for the state of the dynamic program. City 0 is where every
+ * path starts, and the other m = n - 1 cities are bits 0 to m - 1 of a subset,
+ * so city c is bit c - 1. Within a layer, subsets are numbered in increasing
+ * order (the colexicographic order), and a subset of k cities has k costs in a
+ * row, one for each city the path could end at. */
+typedef struct dp {
+	/** the number of cities other than city 0 */
+	int m;
+	/** dense copy of the distance matrix, n by n */
+	int *dist;
+	/** binomial coefficients, binom[a][b] is a choose b */
+	long binom[DP_MAX_CITIES + 1][DP_MAX_CITIES + 1];
+	/** the costs of the previous layer */
+	int *prev;
+	/** the costs of the layer being computed */
+	int *cur;
+	/** for each layer, the city before the last on each path this process
+	 * computed */
+	unsigned char **parents;
+	/** whether layers live in temporary files */
+	Boolean spill;
+	/** rank of this process */
+	int rank;
+	/** number of processes */
+	int size;
+} Dp;
+
+/** a container for the share of a layer computed by one thread */
+typedef struct slice {
+	/** the shared state of the dynamic program */
+	Dp *dp;
+	/** the size of the subsets in the layer */
+	int k;
+	/** index of the first subset this process owns in the layer */
+	long first;
+	/** index of the first subset of the slice */
+	long lo;
+	/** index one past the last subset of the slice */
+	long hi;
+} Slice;
+
+/*--- function prototypes ----------------------------------------------------*/
+
+static void *fill_slice(void *arg);
+static long layer_lo(Dp *dp, int k, int rank);
+static long subset_rank(Dp *dp, unsigned int set);
+static unsigned int subset_unrank(Dp *dp, long rank, int k);
+static unsigned int next_subset(unsigned int set);
+static int position(unsigned int set, int bit);
+static void *layer_alloc(size_t bytes, Boolean spill);
+static void layer_free(void *layer, size_t bytes, Boolean spill);
+
+/*--- dynamic programming interface ------------------------------------------*/
+
+Partial_tour *held_karp(Graph *graph, int num_cities, int num_threads,
+		long memory_limit)
+{
+	Dp dp;
+	Slice *slices;
+	pthread_t *threads;
+	Partial_tour *tour;
+	int k, n = num_cities, m = num_cities - 1, end, city, *counts, *displs;
+	long lo, hi, peak, parents, bytes;
+	unsigned int set;
+	int best, cost, parent;
+
+	tour = tour_init(num_cities);
+	add_city(tour, 0, 0);
+	if (n < 2 || n > DP_MAX_CITIES) {
+		add_city(tour, 0, INT_MAX);
+		return tour;
+	}
+
+	dp.m = m;
+	MPI_Comm_rank(MPI_COMM_WORLD, &dp.rank);
+	MPI_Comm_size(MPI_COMM_WORLD, &dp.size);
+	dp.dist = (int *) malloc(sizeof(int) * n * n);
+	for (int i = 0; i < n; i++) {
+		for (int j = 0; j < n; j++) {
+			dp.dist[i*n + j] = (i == j) ? NO_EDGE : edge_weight(graph, i, j);
+		}
+	}
+	for (int a = 0; a <= m; a++) {
+		dp.binom[a][0] = 1;
+		for (int b = 1; b <= m; b++) {
+			dp.binom[a][b] = (a == 0) ? 0 : dp.binom[a-1][b-1] + dp.binom[a-1][b];
+		}
+	}
+
+	/* work out whether two layers and our share of the parents fit */
+	peak = 0;
+	parents = 0;
+	for (k = 1; k <= m; k++) {
+		bytes = sizeof(int) * (dp.binom[m][k] * k + dp.binom[m][k-1] * (k-1));
+		peak = (bytes > peak) ? bytes : peak;
+		parents += dp.binom[m][k] * k / dp.size + k;
+	}
+	dp.spill = memory_limit > 0 && peak + parents > memory_limit;
+
+	dp.parents = (unsigned char **) calloc(m + 1, sizeof(unsigned char *));
+	counts = (int *) malloc(sizeof(int) * dp.size);
+	displs = (int *) malloc(sizeof(int) * dp.size);
+	slices = (Slice *) malloc(sizeof(Slice) * num_threads);
+	threads = (pthread_t *) malloc(sizeof(pthread_t) * num_threads);
+	dp.prev = NULL;
+
+	for (k = 1; k <= m; k++) {
+		/* our share of the layer, which the threads split between them */
+		lo = layer_lo(&dp, k, dp.rank);
+		hi = layer_lo(&dp, k, dp.rank + 1);
+		dp.cur = (int *) layer_alloc(sizeof(int) * dp.binom[m][k] * k,
+				dp.spill);
+		dp.parents[k] = (unsigned char *) layer_alloc((hi - lo) * k + 1,
+				dp.spill);
+		for (int t = 0; t < num_threads; t++) {
+			slices[t].dp = &dp;
+			slices[t].k = k;
+			slices[t].first = lo;
+			slices[t].lo = lo + (hi - lo) * t / num_threads;
+			slices[t].hi = lo + (hi - lo) * (t + 1) / num_threads;
+		}
+		for (int t = 1; t < num_threads; t++) {
+			pthread_create(&threads[t], NULL, fill_slice, &slices[t]);
+		}
+		fill_slice(&slices[0]);
+		for (int t = 1; t < num_threads; t++) {
+			pthread_join(threads[t], NULL);
+		}
+
+		/* every process needs the whole layer to compute the next one */
+		for (int r = 0; r < dp.size; r++) {
+			displs[r] = layer_lo(&dp, k, r) * k;
+			counts[r] = layer_lo(&dp, k, r + 1) * k - displs[r];
+		}
+		MPI_Allgatherv(MPI_IN_PLACE, 0, MPI_DATATYPE_NULL, dp.cur, counts,
+				displs, MPI_INT, MPI_COMM_WORLD);
+
+		if (dp.prev != NULL) {
+			layer_free(dp.prev, sizeof(int) * dp.binom[m][k-1] * (k-1),
+					dp.spill);
+		}
+		dp.prev = dp.cur;
+	}
+
+	/* close the cheapest path back to city 0 */
+	set = (1u << m) - 1;
+	best = INFINITE;
+	end = -1;
+	for (int j = 0; j < m; j++) {
+		if (dp.prev[j] != INFINITE && dp.dist[(j+1)*n] != NO_EDGE) {
+			cost = dp.prev[j] + dp.dist[(j+1)*n];
+			if (cost < best) {
+				best = cost;
+				end = j;
+			}
+		}
+	}
+
+	/* follow the parents back from the end of the path, asking whichever
+	 * process computed each step to share it */
+	if (end != -1) {
+		int *route = (int *) malloc(sizeof(int) * (m + 1));
+		city = end + 1;
+		for (k = m; k >= 1; k--) {
+			long idx = subset_rank(&dp, set);
+			int owner = dp.size - 1;
+			while (layer_lo(&dp, k, owner) > idx) {
+				owner--;
+			}
+			route[k] = city;
+			if (owner == dp.rank) {
+				parent = dp.parents[k][(idx - layer_lo(&dp, k, owner)) * k
+					+ position(set, city - 1)];
+			}
+			MPI_Bcast(&parent, 1, MPI_INT, owner, MPI_COMM_WORLD);
+			set &= ~(1u << (city - 1));
+			city = parent;
+		}
+		route[0] = 0;
+		for (k = 1; k <= m; k++) {
+			add_city(tour, route[k], dp.dist[route[k-1] * n + route[k]]);
+		}
+		add_city(tour, 0, dp.dist[route[m] * n]);
+		free(route);
+	} else {
+		add_city(tour, 0, INT_MAX);
+	}
+
+	layer_free(dp.prev, sizeof(int) * dp.binom[m][m] * m, dp.spill);
+	for (k = 1; k <= m; k++) {
+		lo = layer_lo(&dp, k, dp.rank);
+		hi = layer_lo(&dp, k, dp.rank + 1);
+		layer_free(dp.parents[k], (hi - lo) * k + 1, dp.spill);
+	}
+	free(dp.parents);
+	free(dp.dist);
+	free(counts);
+	free(displs);
+	free(slices);
+	free(threads);
+
+	return tour;
+}
+
+/*--- utility functions ------------------------------------------------------*/
+
+/** Compute the costs of the paths ending at each city of the subsets in a
+ * slice of a layer, extending the best path to each of the others. */
+static void *fill_slice(void *arg)
+{
+	Slice *slice = (Slice *) arg;
+	Dp *dp = slice->dp;
+	int k = slice->k, n = dp->m + 1, p, q, best, parent, w;
+	unsigned int set, rest, prev, from;
+	const int *base;
+
+	if (slice->lo >= slice->hi) {
+		return NULL;
+	}
+
+	set = subset_unrank(dp, slice->lo, k);
+	for (long idx = slice->lo; idx < slice->hi; idx++) {
+		/* for each city j in the set, take the best path over the rest */
+		for (rest = set, p = 0; rest; rest &= rest - 1, p++) {
+			int j = __builtin_ctz(rest);
+			if (k == 1) {
+				best = dp->dist[j + 1];
+				best = (best == NO_EDGE) ? INFINITE : best;
+				parent = 0;
+			} else {
+				prev = set & ~(1u << j);
+				base = dp->prev + subset_rank(dp, prev) * (k - 1);
+				best = INFINITE;
+				parent = 0;
+				for (from = prev, q = 0; from; from &= from - 1, q++) {
+					int i = __builtin_ctz(from);
+					w = dp->dist[(i + 1) * n + j + 1];
+					if (base[q] != INFINITE && w != NO_EDGE
+							&& base[q] + w < best) {
+						best = base[q] + w;
+						parent = i + 1;
+					}
+				}
+			}
+			dp->cur[idx * k + p] = best;
+			dp->parents[k][(idx - slice->first) * k + p] = parent;
+		}
+		set = next_subset(set);
+	}
+
+	return NULL;
+}
+
+/** Return the index of the first subset of layer k that a process computes */
+static long layer_lo(Dp *dp, int k, int rank)
+{
+	return dp->binom[dp->m][k] * rank / dp->size;
+}
+
+/** Return the index of a subset within its layer, which is the sum of
+ * binom[b][i] over its i-th smallest bit b */
+static long subset_rank(Dp *dp, unsigned int set)
+{
+	long rank = 0;
+	for (int i = 1; set; set &= set - 1, i++) {
+		rank += dp->binom[__builtin_ctz(set)][i];
+	}
+	return rank;
+}
+
+/** Return the subset of k cities with the specified index in its layer */
+static unsigned int subset_unrank(Dp *dp, long rank, int k)
+{
+	unsigned int set = 0;
+	int b = dp->m - 1;
+	for (int i = k; i >= 1; i--) {
+		while (dp->binom[b][i] > rank) {
+			b--;
+		}
+		set |= 1u << b;
+		rank -= dp->binom[b--][i];
+	}
+	return set;
+}
+
+/** Return the next larger subset with as many cities (Gosper's hack) */
+static unsigned int next_subset(unsigned int set)
+{
+	unsigned int low = set & -set;
+	unsigned int ripple = set + low;
+	return (((ripple ^ set) >> 2) / low) | ripple;
+}
+
+/** Return how many cities of the set come before the specified bit */
+static int position(unsigned int set, int bit)
+{
+	return __builtin_popcount(set & ((1u << bit) - 1));
+}
+
+/** Allocate a layer, in memory or in a temporary file mapped into memory */
+static void *layer_alloc(size_t bytes, Boolean spill)
+{
+	char path[PATH_MAX];
+	const char *dir = getenv("TMPDIR");
+	void *layer;
+	int fd;
+
+	if (!spill) {
+		return malloc(bytes);
+	}
+
+	/* the file disappears once it is unmapped */
+	snprintf(path, PATH_MAX, "%s/tsp-layer-XXXXXX", dir ? dir : "/tmp");
+	fd = mkstemp(path);
+	if (fd == -1 || ftruncate(fd, bytes) == -1) {
+		perror("held_karp");
+		MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+	}
+	unlink(path);
+	layer = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (layer == MAP_FAILED) {
+		perror("held_karp");
+		MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+	}
+	return layer;
+}
+
+/** Free a layer allocated by layer_alloc */
+static void layer_free(void *layer, size_t bytes, Boolean spill)
+{
+	if (spill) {
+		munmap(layer, bytes);
+	} else {
+		free(layer);
+	}
+}
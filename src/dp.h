@@ -0,0 +1,43 @@
+/**
+ * @file    dp.h
+ * @brief   Held-Karp dynamic programming solver for exact medium instances.
+ * @author  L. Foxcroft
+ * @date    2022-06-15
+ */
+
+#ifndef DP_H
+#define DP_H
+
+#include "graph.h"
+#include "stack.h"
+
+/** the most cities the dynamic programming solver can handle */
+#define DP_MAX_CITIES 30
+
+/*--- function prototypes ----------------------------------------------------*/
+
+/**
+ * Finds the best tour with the Held-Karp bitmask dynamic program, which takes
+ * O(n^2 2^n) time. Subsets of cities are processed one layer (subsets of the
+ * same size) at a time, so only two layers of costs are held at once. Each
+ * layer is split between the processes, and each process's share between
+ * num_threads threads. If the layers would take up more than memory_limit
+ * bytes they are kept in temporary files mapped into memory instead, so the
+ * operating system can page them out. Every process in MPI_COMM_WORLD should
+ * call this at the same time, and only the calling thread makes MPI calls.
+ *
+ * @param[in]   graph
+ *     a pointer to the graph to solve
+ * @param[in]   num_cities
+ *     the number of cities in the graph, at most DP_MAX_CITIES
+ * @param[in]   num_threads
+ *     the number of threads each process computes a layer with
+ * @param[in]   memory_limit
+ *     the most bytes the layers may take up in memory, or 0 for no limit
+ * @return      the best tour, which is the same on every process and has a cost
+ *              of INT_MAX if there is no tour
+ */
+Partial_tour *held_karp(Graph *graph, int num_cities, int num_threads,
+		long memory_limit);
+
+#endif /* DP_H */
@@ -1,106 +1,327 @@
 /**
  * @file    graph.c
- * @brief   Adjacency list representation of an undirected graph.
+ * @brief   Contiguous representations of an undirected or directed graph: a
+ *          distance matrix for dense graphs and compressed sparse rows for
+ *          sparse ones.
  * @author  L. Foxcroft
  * @date    2022-06-03
  */
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include "graph.h"
 
-/** a node container */
-struct node {
-	/** represents the city in this problem */
-	int dest;
-	/** weight of the edge from src to dest if node is in list indexed by src */
-	int dist;
-	/** next node adjacent to src in linked list */
-	struct node *next;
-};
+/* number of ints in a 64 byte cache line, which every row is aligned to */
+#define ROW_ALIGN 16
+/* graphs with at least this fraction of all possible edges are stored dense */
+#define DENSE_FRACTION 0.25
 
 /** a graph container */
 struct graph {
 	/** the number of vertices in the graph */
 	int vertices;
-	/** a list of pointers to the adjacency lists */
-	struct node **nodes;
+	/** how the edges are stored */
+	Backend backend;
+	/** whether an edge may weigh something different, or be missing, in the
+	 * other direction */
+	Boolean directed;
+	/** number of ints between the start of consecutive rows */
+	int stride;
+	/** dense: vertices rows of stride weights, NO_EDGE if there is no edge */
+	int *matrix;
+	/** sparse: index of the start of each row in dests and dists */
+	int *offsets;
+	/** sparse: number of neighbours of each vertex */
+	int *degree;
+	/** sparse: neighbours of each vertex, in increasing order */
+	int *dests;
+	/** sparse: weights of the edges to the neighbours in dests */
+	int *dists;
+	/** the weight of the cheapest edge leaving each vertex */
+	int *min_dist;
+	/** the weight of the second cheapest edge leaving each vertex */
+	int *min2_dist;
+	/** index of the start of each vertex's neighbours in by_cost_dests */
+	int *by_cost_offsets;
+	/** the neighbours of each vertex, cheapest edge first */
+	int *by_cost_dests;
+	/** the weights of the edges to the neighbours in by_cost_dests */
+	int *by_cost_dists;
 };
 
+/** an edge leaving a vertex, used while building sparse rows */
+typedef struct arc {
+	int dest;
+	int dist;
+} Arc;
+
 /*--- function prototypes ----------------------------------------------------*/
 
-static Graph *graph_init(int vertices);
-static Boolean graph_add_edge(Graph *graph, int from, int to, int weight);
+static Graph *graph_init(int vertices, Backend backend);
+static Graph *build_edges(int v, int e, int **edges, Backend backend,
+		Boolean directed);
+static void build_dense(Graph *graph, int e, int **edges);
+static void build_sparse(Graph *graph, int e, int **edges);
+static void find_min_edges(Graph *graph);
+static void check_symmetry(Graph *graph);
+static void sort_by_cost(Graph *graph);
+static Boolean valid_edge(Graph *graph, int *edge);
+static int *aligned_ints(long count);
+static long round_up(long count);
+static int compare_arcs(const void *a, const void *b);
+static int compare_arc_costs(const void *a, const void *b);
+static void set_arc(Graph *graph, int from, int to, int weight);
+static void set_sparse_arc(Graph *graph, int from, int to, int weight);
+static void move_by_cost(Graph *graph, int from, int to, int weight);
+static void reshape_by_cost(Graph *graph, int from, int to, int old,
+		int weight);
+static void make_room(Graph *graph, int from, int to, int weight);
+static Arc by_cost_arc(Graph *graph, int i);
 
 /*--- graph interface --------------------------------------------------------*/
 
 Graph *scan_graph()
 {
-	int v, e, v1, v2, w;
+	int v, e, **edges;
+	Graph *graph;
+
+	/* scanf rather than a buffered reader, since callers may carry on reading
+	 * standard in, but the edges still go in one block */
 	scanf("%d %d", &v, &e);
-	Graph *graph = graph_init(v);
+	edges = (int **) malloc(sizeof(int *) * (e > 0 ? e : 1));
+	edges[0] = (int *) malloc(sizeof(int) * 3 * (e > 0 ? e : 1));
 	for (int i = 0; i < e; i++) {
-		scanf("%d %d %d", &v1, &v2, &w);
-		if (!graph_add_edge(graph, v1, v2, w)) {
-			printf("Could not add edge from %d to %d with weight %d\n",
-					v1, v2, w);
-		}
-		if (!graph_add_edge(graph, v2, v1, w)) {
-			printf("Could not add edge from %d to %d with weight %d\n",
-					v2, v1, w);
-		}
+		edges[i] = edges[0] + 3 * i;
+		scanf("%d %d %d", &edges[i][0], &edges[i][1], &edges[i][2]);
 	}
+
+	graph = build_graph(v, e, edges);
+
+	free(edges[0]);
+	free(edges);
+
 	return graph;
 }
 
 Graph *build_graph(int v, int e, int **edges)
 {
-	Graph *graph = graph_init(v);
-	for (int i = 0; i < e; i++) {
-		if (!graph_add_edge(graph, edges[i][0], edges[i][1], edges[i][2])) {
-			printf("Could not add edge from %d to %d with weight %d\n",
-					edges[i][0], edges[i][1], edges[i][2]);
+	return build_graph_backend(v, e, edges, GRAPH_AUTO);
+}
+
+Graph *build_graph_backend(int v, int e, int **edges, Backend backend)
+{
+	return build_edges(v, e, edges, backend, FALSE);
+}
+
+Graph *build_directed_graph(int v, int e, int **edges)
+{
+	return build_edges(v, e, edges, GRAPH_AUTO, TRUE);
+}
+
+Graph *build_graph_matrix(int v, const int *matrix, Boolean directed)
+{
+	int weight;
+	Graph *graph = graph_init(v, GRAPH_DENSE);
+	long size = (long) v * graph->stride;
+
+	graph->directed = directed;
+	graph->matrix = aligned_ints(size);
+	for (int from = 0; from < v; from++) {
+		for (int to = 0; to < graph->stride; to++) {
+			weight = NO_EDGE;
+			if (to < v && to != from) {
+				weight = matrix[(long) from * v + to];
+				if (!directed && matrix[(long) to * v + from] < weight) {
+					weight = matrix[(long) to * v + from];
+				}
+			}
+			graph->matrix[(long) from * graph->stride + to] = weight;
 		}
-		if (!graph_add_edge(graph, edges[i][1], edges[i][0], edges[i][2])) {
-			printf("Could not add edge from %d to %d with weight %d\n",
-					edges[i][1], edges[i][0], edges[i][2]);
+	}
+	check_symmetry(graph);
+	find_min_edges(graph);
+	sort_by_cost(graph);
+
+	return graph;
+}
+
+Graph *build_graph_function(int v, int (*distance)(void *, int, int),
+		void *data)
+{
+	int weight;
+	Graph *graph = graph_init(v, GRAPH_DENSE);
+	long size = (long) v * graph->stride;
+
+	graph->matrix = aligned_ints(size);
+	for (long i = 0; i < size; i++) {
+		graph->matrix[i] = NO_EDGE;
+	}
+	for (int from = 0; from < v; from++) {
+		for (int to = from + 1; to < v; to++) {
+			weight = distance(data, from, to);
+			graph->matrix[(long) from * graph->stride + to] = weight;
+			graph->matrix[(long) to * graph->stride + from] = weight;
 		}
 	}
+	find_min_edges(graph);
+	sort_by_cost(graph);
+
 	return graph;
 }
 
-Boolean adj(Graph *graph, int *city, int *neighbour, int *cost)
+Backend graph_backend(Graph *graph)
 {
-	static Node *n;
+	return graph->backend;
+}
+
+Boolean graph_directed(Graph *graph)
+{
+	return graph->directed;
+}
 
+Boolean adj(Graph *graph, Adj_iter *iter, int *city, int *neighbour,
+		int *cost)
+{
 	if (city != NULL) {
 		if (*city < 0 || *city >= graph->vertices) {
 			return FALSE;
 		}
-		n = graph->nodes[*city];
+		if (graph->backend == GRAPH_DENSE) {
+			iter->dests = NULL;
+			iter->dists = graph->matrix + (long) *city * graph->stride;
+			iter->end = graph->vertices;
+		} else {
+			iter->dests = graph->dests + graph->offsets[*city];
+			iter->dists = graph->dists + graph->offsets[*city];
+			iter->end = graph->degree[*city];
+		}
+		iter->next = 0;
 	} /* else it has already been cached */
 
+	/* skip the gaps in a matrix row */
+	if (iter->dests == NULL) {
+		while (iter->next < iter->end && iter->dists[iter->next] == NO_EDGE) {
+			iter->next++;
+		}
+	}
+
 	/* return if next adjacent node does not exist */
-	if (n == NULL) {
+	if (iter->next >= iter->end) {
 		return FALSE;
 	}
 
 	/* read values of adjacent node into pointers */
-	*neighbour = n->dest;
-	*cost = n->dist;
-	n = n->next;
+	*neighbour = (iter->dests == NULL) ? iter->next : iter->dests[iter->next];
+	*cost = iter->dists[iter->next];
+	iter->next++;
+
+	return TRUE;
+}
+
+int edge_weight(Graph *graph, int from, int to)
+{
+	int lo, hi, mid;
+	const int *dests;
+
+	if (graph->backend == GRAPH_DENSE) {
+		return graph->matrix[(long) from * graph->stride + to];
+	}
+
+	/* binary search the sorted row */
+	dests = graph->dests + graph->offsets[from];
+	lo = 0;
+	hi = graph->degree[from] - 1;
+	while (lo <= hi) {
+		mid = (lo + hi) / 2;
+		if (dests[mid] == to) {
+			return graph->dists[graph->offsets[from] + mid];
+		} else if (dests[mid] < to) {
+			lo = mid + 1;
+		} else {
+			hi = mid - 1;
+		}
+	}
+	return NO_EDGE;
+}
 
+Boolean set_edge_weight(Graph *graph, int from, int to, int weight)
+{
+	if (from < 0 || from >= graph->vertices || to < 0
+			|| to >= graph->vertices || from == to) {
+		return FALSE;
+	}
+	make_room(graph, from, to, weight);
+	set_arc(graph, from, to, weight);
+	if (!graph->directed) {
+		make_room(graph, to, from, weight);
+		set_arc(graph, to, from, weight);
+	}
 	return TRUE;
 }
 
+const int *graph_row(Graph *graph, int city)
+{
+	if (graph->backend != GRAPH_DENSE) {
+		return NULL;
+	}
+	return graph->matrix + (long) city * graph->stride;
+}
+
+int min_edge(Graph *graph, int city)
+{
+	if (graph->min_dist[city] == NO_EDGE) {
+		return 0;
+	}
+	return graph->min_dist[city];
+}
+
+int second_min_edge(Graph *graph, int city)
+{
+	if (graph->min2_dist[city] == NO_EDGE) {
+		return 0;
+	}
+	return graph->min2_dist[city];
+}
+
+int neighbours_by_cost(Graph *graph, int city, const int **neighbours,
+		const int **costs)
+{
+	int start;
+
+	if (city < 0 || city >= graph->vertices) {
+		return 0;
+	}
+	start = graph->by_cost_offsets[city];
+
+	if (neighbours != NULL) {
+		*neighbours = graph->by_cost_dests + start;
+	}
+	if (costs != NULL) {
+		*costs = graph->by_cost_dists + start;
+	}
+	return graph->by_cost_offsets[city+1] - start;
+}
+
+int candidates(Graph *graph, int city, int k, const int **neighbours)
+{
+	int degree = neighbours_by_cost(graph, city, neighbours, NULL);
+	return (k < degree) ? k : degree;
+}
+
 void print_graph(Graph *graph)
 {
+	int city, neighbour, cost;
+	Adj_iter iter;
+	Boolean found;
+
 	for (int i = 0; i < graph->vertices; i++) {
 		printf("%d: ", i);
-		Node *n = graph->nodes[i];
-		while (n != NULL) {
-			printf("%d (%d), ", n->dest, n->dist);
-			n = n->next;
+		city = i;
+		found = adj(graph, &iter, &city, &neighbour, &cost);
+		while (found) {
+			printf("%d (%d), ", neighbour, cost);
+			found = adj(graph, &iter, NULL, &neighbour, &cost);
 		}
 		printf("\n");
 	}
@@ -108,57 +329,477 @@ void print_graph(Graph *graph)
 
 void free_graph(Graph *graph)
 {
-	int i;
-	Node *p, *q;
-
-	/* Free linked lists pointed to by graph */
-	for (i = 0; i < graph->vertices; i++) {
-		p = graph->nodes[i];
-		while (p != NULL) {
-			q = p->next;
-			free(p);
-			p = q;
-		}
-	}
-
-	/* Free graph */
-	free(graph->nodes);
+	free(graph->matrix);
+	free(graph->offsets);
+	free(graph->degree);
+	free(graph->dests);
+	free(graph->dists);
+	free(graph->min_dist);
+	free(graph->min2_dist);
+	free(graph->by_cost_offsets);
+	free(graph->by_cost_dests);
+	free(graph->by_cost_dists);
 	free(graph);
 }
 
 /*--- utility functions ------------------------------------------------------*/
 
-/** Initialize an adjacency list with 'vertices' nodes */
-static Graph *graph_init(int vertices)
+/** Initialize an empty graph with 'vertices' vertices */
+static Graph *graph_init(int vertices, Backend backend)
 {
 	Graph *graph = (Graph *) malloc(sizeof(Graph));
 	graph->vertices = vertices;
-	graph->nodes = (Node **) malloc(sizeof(Node **) * vertices);
-	for (int i = 0; i < vertices; i++) {
-		graph->nodes[i] = NULL;
+	graph->backend = backend;
+	graph->directed = FALSE;
+	graph->stride = round_up(vertices);
+	graph->matrix = NULL;
+	graph->offsets = NULL;
+	graph->degree = NULL;
+	graph->dests = NULL;
+	graph->dists = NULL;
+	graph->min_dist = (int *) malloc(sizeof(int) * vertices);
+	graph->min2_dist = (int *) malloc(sizeof(int) * vertices);
+	graph->by_cost_offsets = NULL;
+	graph->by_cost_dests = NULL;
+	graph->by_cost_dists = NULL;
+	return graph;
+}
+
+/** Build a graph from an edge list, or from a list of arcs if it is directed,
+ * picking the backend from its density if it is GRAPH_AUTO */
+static Graph *build_edges(int v, int e, int **edges, Backend backend,
+		Boolean directed)
+{
+	Graph *graph;
+
+	/* an undirected edge is stored in both directions, and an arc in one */
+	if (backend == GRAPH_AUTO) {
+		if (v <= ROW_ALIGN || (directed ? 1.0 : 2.0) * e
+				>= DENSE_FRACTION * v * (v - 1.0)) {
+			backend = GRAPH_DENSE;
+		} else {
+			backend = GRAPH_SPARSE;
+		}
+	}
+
+	graph = graph_init(v, backend);
+	graph->directed = directed;
+	if (backend == GRAPH_DENSE) {
+		build_dense(graph, e, edges);
+	} else {
+		build_sparse(graph, e, edges);
 	}
+	check_symmetry(graph);
+	find_min_edges(graph);
+	sort_by_cost(graph);
+
 	return graph;
 }
 
-/** Add an edge from 'from' to 'to' with specified weight */
-static Boolean graph_add_edge(Graph *graph, int from, int to, int weight)
+/** Fill in a distance matrix from an edge list, keeping the cheapest of any
+ * duplicate edges */
+static void build_dense(Graph *graph, int e, int **edges)
 {
-	if (from >= graph->vertices || to >= graph->vertices) {
-		return FALSE;
+	int from, to, weight;
+	long size = (long) graph->vertices * graph->stride;
+
+	graph->matrix = aligned_ints(size);
+	for (long i = 0; i < size; i++) {
+		graph->matrix[i] = NO_EDGE;
+	}
+
+	for (int i = 0; i < e; i++) {
+		if (!valid_edge(graph, edges[i])) {
+			continue;
+		}
+		from = edges[i][0];
+		to = edges[i][1];
+		weight = edges[i][2];
+		if (weight < graph->matrix[(long) from * graph->stride + to]) {
+			graph->matrix[(long) from * graph->stride + to] = weight;
+			if (!graph->directed) {
+				graph->matrix[(long) to * graph->stride + from] = weight;
+			}
+		}
 	}
+}
+
+/** Fill in compressed sparse rows from an edge list. Each row is sorted by
+ * neighbour and keeps the cheapest of any duplicate edges. */
+static void build_sparse(Graph *graph, int e, int **edges)
+{
+	int v = graph->vertices, from, to, weight, count, *fill;
+	Arc *arcs;
+
+	/* count the edges leaving every vertex to lay out the rows */
+	graph->offsets = (int *) malloc(sizeof(int) * (v + 1));
+	graph->degree = (int *) calloc(v, sizeof(int));
+	for (int i = 0; i < e; i++) {
+		if (valid_edge(graph, edges[i])) {
+			graph->degree[edges[i][0]]++;
+			graph->degree[edges[i][1]] += !graph->directed;
+		}
+	}
+	graph->offsets[0] = 0;
+	for (int i = 0; i < v; i++) {
+		graph->offsets[i+1] = graph->offsets[i] + round_up(graph->degree[i]);
+	}
+
+	/* scatter the edges into their rows */
+	arcs = (Arc *) malloc(sizeof(Arc) * (graph->offsets[v] + 1));
+	fill = (int *) calloc(v, sizeof(int));
+	for (int i = 0; i < e; i++) {
+		if (!valid_edge(graph, edges[i])) {
+			continue;
+		}
+		from = edges[i][0];
+		to = edges[i][1];
+		weight = edges[i][2];
+		arcs[graph->offsets[from] + fill[from]].dest = to;
+		arcs[graph->offsets[from] + fill[from]++].dist = weight;
+		if (!graph->directed) {
+			arcs[graph->offsets[to] + fill[to]].dest = from;
+			arcs[graph->offsets[to] + fill[to]++].dist = weight;
+		}
+	}
+
+	/* sort each row, merge duplicates and copy into the aligned arrays */
+	graph->dests = aligned_ints(graph->offsets[v]);
+	graph->dists = aligned_ints(graph->offsets[v]);
+	for (int i = 0; i < v; i++) {
+		Arc *row = arcs + graph->offsets[i];
+		qsort(row, graph->degree[i], sizeof(Arc), compare_arcs);
+		count = 0;
+		for (int j = 0; j < graph->degree[i]; j++) {
+			if (count > 0 && row[count-1].dest == row[j].dest) {
+				if (row[j].dist < row[count-1].dist) {
+					row[count-1].dist = row[j].dist;
+				}
+			} else {
+				row[count++] = row[j];
+			}
+		}
+		graph->degree[i] = count;
+		for (int j = 0; j < count; j++) {
+			graph->dests[graph->offsets[i] + j] = row[j].dest;
+			graph->dists[graph->offsets[i] + j] = row[j].dist;
+		}
+	}
+
+	free(fill);
+	free(arcs);
+}
+
+/** Record the two cheapest edges leaving every vertex, to distinct neighbours,
+ * once the duplicate edges have been merged */
+static void find_min_edges(Graph *graph)
+{
+	int city, neighbour, cost;
+	Adj_iter iter;
+	Boolean found;
+
+	for (int i = 0; i < graph->vertices; i++) {
+		graph->min_dist[i] = NO_EDGE;
+		graph->min2_dist[i] = NO_EDGE;
+		city = i;
+		found = adj(graph, &iter, &city, &neighbour, &cost);
+		while (found) {
+			if (cost < graph->min_dist[i]) {
+				graph->min2_dist[i] = graph->min_dist[i];
+				graph->min_dist[i] = cost;
+			} else if (cost < graph->min2_dist[i]) {
+				graph->min2_dist[i] = cost;
+			}
+			found = adj(graph, &iter, NULL, &neighbour, &cost);
+		}
+	}
+}
+
+/** Treat a directed graph as undirected if every arc is matched by one of the
+ * same weight the other way, so that the search can use the symmetric bounds
+ * and skip reversed tours */
+static void check_symmetry(Graph *graph)
+{
+	int city, neighbour, cost;
+	Adj_iter iter;
+	Boolean found, symmetric = TRUE;
+
+	for (int i = 0; graph->directed && symmetric && i < graph->vertices; i++) {
+		city = i;
+		found = adj(graph, &iter, &city, &neighbour, &cost);
+		while (found && symmetric) {
+			symmetric = edge_weight(graph, neighbour, i) == cost;
+			found = adj(graph, &iter, NULL, &neighbour, &cost);
+		}
+	}
+	graph->directed = graph->directed && !symmetric;
+}
+
+/** List the neighbours of every vertex in order of the weight of the edge to
+ * them, breaking ties by neighbour so that every process agrees on the order */
+static void sort_by_cost(Graph *graph)
+{
+	int v = graph->vertices, city, neighbour, cost, count, max_degree = 0;
+	Adj_iter iter;
+	Arc *row;
+	Boolean found;
+
+	/* count the neighbours of every vertex to lay out the lists */
+	graph->by_cost_offsets = (int *) malloc(sizeof(int) * (v + 1));
+	graph->by_cost_offsets[0] = 0;
+	for (int i = 0; i < v; i++) {
+		count = 0;
+		city = i;
+		found = adj(graph, &iter, &city, &neighbour, &cost);
+		while (found) {
+			count++;
+			found = adj(graph, &iter, NULL, &neighbour, &cost);
+		}
+		graph->by_cost_offsets[i+1] = graph->by_cost_offsets[i] + count;
+		max_degree = (count > max_degree) ? count : max_degree;
+	}
+
+	graph->by_cost_dests = (int *) malloc(sizeof(int)
+			* (graph->by_cost_offsets[v] + 1));
+	graph->by_cost_dists = (int *) malloc(sizeof(int)
+			* (graph->by_cost_offsets[v] + 1));
+	row = (Arc *) malloc(sizeof(Arc) * (max_degree + 1));
+	for (int i = 0; i < v; i++) {
+		count = 0;
+		city = i;
+		found = adj(graph, &iter, &city, &neighbour, &cost);
+		while (found) {
+			row[count].dest = neighbour;
+			row[count++].dist = cost;
+			found = adj(graph, &iter, NULL, &neighbour, &cost);
+		}
+		qsort(row, count, sizeof(Arc), compare_arc_costs);
+		for (int j = 0; j < count; j++) {
+			graph->by_cost_dests[graph->by_cost_offsets[i] + j] = row[j].dest;
+			graph->by_cost_dists[graph->by_cost_offsets[i] + j] = row[j].dist;
+		}
+	}
+
+	free(row);
+}
+
+/** Change the weight of one arc, then bring the cost ordered neighbours and
+ * the two cheapest edges of the city it leaves up to date */
+static void set_arc(Graph *graph, int from, int to, int weight)
+{
+	int old = edge_weight(graph, from, to), start, count;
+
+	if (graph->backend == GRAPH_DENSE) {
+		graph->matrix[(long) from * graph->stride + to] = weight;
+	} else {
+		set_sparse_arc(graph, from, to, weight);
+	}
+
+	if (old != NO_EDGE && weight != NO_EDGE) {
+		move_by_cost(graph, from, to, weight);
+	} else if (old != weight) {
+		reshape_by_cost(graph, from, to, old, weight);
+	}
+
+	/* the two cheapest edges head the cost ordered neighbours */
+	start = graph->by_cost_offsets[from];
+	count = graph->by_cost_offsets[from+1] - start;
+	graph->min_dist[from] = (count > 0)
+		? graph->by_cost_dists[start] : NO_EDGE;
+	graph->min2_dist[from] = (count > 1)
+		? graph->by_cost_dists[start + 1] : NO_EDGE;
+}
+
+/** Change, add or remove an arc in a sparse row, keeping the row sorted by
+ * neighbour. An added arc goes in the padding at the end of the row, which
+ * make_room has made sure there is space for. */
+static void set_sparse_arc(Graph *graph, int from, int to, int weight)
+{
+	int *dests = graph->dests + graph->offsets[from];
+	int *dists = graph->dists + graph->offsets[from];
+	int degree = graph->degree[from], slot = 0;
+
+	while (slot < degree && dests[slot] < to) {
+		slot++;
+	}
+	if (slot < degree && dests[slot] == to) {
+		if (weight != NO_EDGE) {
+			dists[slot] = weight;
+		} else {
+			memmove(dests + slot, dests + slot + 1,
+					sizeof(int) * (degree - slot - 1));
+			memmove(dists + slot, dists + slot + 1,
+					sizeof(int) * (degree - slot - 1));
+			graph->degree[from]--;
+		}
+	} else if (weight != NO_EDGE) {
+		memmove(dests + slot + 1, dests + slot, sizeof(int) * (degree - slot));
+		memmove(dists + slot + 1, dists + slot, sizeof(int) * (degree - slot));
+		dests[slot] = to;
+		dists[slot] = weight;
+		graph->degree[from]++;
+	}
+}
+
+/** Move a neighbour whose edge has changed weight to its new place among the
+ * cost ordered neighbours of a city, leaving the rest of the list alone */
+static void move_by_cost(Graph *graph, int from, int to, int weight)
+{
+	int start = graph->by_cost_offsets[from];
+	int end = graph->by_cost_offsets[from+1], i = start;
+	Arc arc = {to, weight}, other;
+
+	while (graph->by_cost_dests[i] != to) {
+		i++;
+	}
+	/* shift dearer neighbours down past it, or cheaper ones up */
+	for (; i > start; i--) {
+		other = by_cost_arc(graph, i - 1);
+		if (compare_arc_costs(&other, &arc) <= 0) {
+			break;
+		}
+		graph->by_cost_dests[i] = other.dest;
+		graph->by_cost_dists[i] = other.dist;
+	}
+	for (; i < end - 1; i++) {
+		other = by_cost_arc(graph, i + 1);
+		if (compare_arc_costs(&arc, &other) <= 0) {
+			break;
+		}
+		graph->by_cost_dests[i] = other.dest;
+		graph->by_cost_dists[i] = other.dist;
+	}
+	graph->by_cost_dests[i] = to;
+	graph->by_cost_dists[i] = weight;
+}
+
+/** Take a neighbour out of the cost ordered neighbours of a city if its edge
+ * was there before, and put it back in order if it still is, moving the lists
+ * of the later cities along rather than sorting anything again */
+static void reshape_by_cost(Graph *graph, int from, int to, int old,
+		int weight)
+{
+	int v = graph->vertices, *offsets = graph->by_cost_offsets;
+	int total = offsets[v], i = offsets[from];
+	Arc arc = {to, weight}, other;
+
+	if (old != NO_EDGE) {
+		while (graph->by_cost_dests[i] != to) {
+			i++;
+		}
+		memmove(graph->by_cost_dests + i, graph->by_cost_dests + i + 1,
+				sizeof(int) * (total - i - 1));
+		memmove(graph->by_cost_dists + i, graph->by_cost_dists + i + 1,
+				sizeof(int) * (total - i - 1));
+		for (int city = from + 1; city <= v; city++) {
+			offsets[city]--;
+		}
+		total--;
+	}
+
+	if (weight != NO_EDGE) {
+		/* grow the lists, keeping one spare entry as sort_by_cost does */
+		graph->by_cost_dests = (int *) realloc(graph->by_cost_dests,
+				sizeof(int) * (total + 2));
+		graph->by_cost_dists = (int *) realloc(graph->by_cost_dists,
+				sizeof(int) * (total + 2));
+		for (i = offsets[from]; i < offsets[from+1]; i++) {
+			other = by_cost_arc(graph, i);
+			if (compare_arc_costs(&arc, &other) < 0) {
+				break;
+			}
+		}
+		memmove(graph->by_cost_dests + i + 1, graph->by_cost_dests + i,
+				sizeof(int) * (total - i));
+		memmove(graph->by_cost_dists + i + 1, graph->by_cost_dists + i,
+				sizeof(int) * (total - i));
+		graph->by_cost_dests[i] = to;
+		graph->by_cost_dists[i] = weight;
+		for (int city = from + 1; city <= v; city++) {
+			offsets[city]++;
+		}
+	}
+}
 
-	/* Add node to front of linked list indexed by from */
-	Node *n1 = (Node *) malloc(sizeof(Node));
+/** Make sure an arc can be given a weight. A distance matrix always has room,
+ * but a sparse row only has room for new neighbours in its padding, so a full
+ * row is given another cache line of padding, moving the later rows along by a
+ * whole cache line so that they stay aligned. */
+static void make_room(Graph *graph, int from, int to, int weight)
+{
+	int v = graph->vertices, end = graph->offsets[from+1];
+	int total = graph->offsets[v], *dests, *dists;
 
-	if (n1 == NULL) {
+	if (graph->backend == GRAPH_DENSE || weight == NO_EDGE
+			|| edge_weight(graph, from, to) != NO_EDGE
+			|| graph->degree[from] < end - graph->offsets[from]) {
+		return;
+	}
+
+	dests = aligned_ints(total + ROW_ALIGN);
+	dists = aligned_ints(total + ROW_ALIGN);
+	memcpy(dests, graph->dests, sizeof(int) * end);
+	memcpy(dists, graph->dists, sizeof(int) * end);
+	memcpy(dests + end + ROW_ALIGN, graph->dests + end,
+			sizeof(int) * (total - end));
+	memcpy(dists + end + ROW_ALIGN, graph->dists + end,
+			sizeof(int) * (total - end));
+	free(graph->dests);
+	free(graph->dists);
+	graph->dests = dests;
+	graph->dists = dists;
+	for (int city = from + 1; city <= v; city++) {
+		graph->offsets[city] += ROW_ALIGN;
+	}
+}
+
+/** Return entry i of the cost ordered neighbours as an arc */
+static Arc by_cost_arc(Graph *graph, int i)
+{
+	Arc arc = {graph->by_cost_dests[i], graph->by_cost_dists[i]};
+	return arc;
+}
+
+/** Return whether an edge joins two distinct vertices of the graph, printing a
+ * message if it leaves the graph */
+static Boolean valid_edge(Graph *graph, int *edge)
+{
+	if (edge[0] < 0 || edge[0] >= graph->vertices
+			|| edge[1] < 0 || edge[1] >= graph->vertices) {
+		printf("Could not add edge from %d to %d with weight %d\n",
+				edge[0], edge[1], edge[2]);
 		return FALSE;
 	}
+	/* loops can never be part of a tour */
+	return edge[0] != edge[1];
+}
 
-	n1->dest = to;
-	n1->dist = weight;
-	n1->next = graph->nodes[from];
-	graph->nodes[from] = n1;
+/** Allocate an array of count ints which starts on a cache line */
+static int *aligned_ints(long count)
+{
+	size_t size = sizeof(int) * round_up(count > 0 ? count : 1);
+	return (int *) aligned_alloc(sizeof(int) * ROW_ALIGN, size);
+}
 
-	return TRUE;
+/** Round count up to a whole number of cache lines worth of ints */
+static long round_up(long count)
+{
+	return (count + ROW_ALIGN - 1) / ROW_ALIGN * ROW_ALIGN;
+}
+
+/** Order arcs by destination */
+static int compare_arcs(const void *a, const void *b)
+{
+	return ((const Arc *) a)->dest - ((const Arc *) b)->dest;
 }
 
+/** Order arcs by weight, then by destination */
+static int compare_arc_costs(const void *a, const void *b)
+{
+	const Arc *x = (const Arc *) a, *y = (const Arc *) b;
+
+	if (x->dist != y->dist) {
+		return (x->dist > y->dist) - (x->dist < y->dist);
+	}
+	return x->dest - y->dest;
+}
@@ -1,6 +1,7 @@
 /**
  * @file    graph.h
- * @brief   An adjacency list implementation for an undirected graph.
+ * @brief   A contiguous (distance matrix or compressed sparse row)
+ *          implementation for an undirected or directed graph.
  * @author  L. Foxcroft
  * @date    2022-06-03
  */
@@ -8,19 +9,43 @@
 #ifndef GRAPH_H
 #define GRAPH_H
 
+#include <limits.h>
 #include "boolean.h"
 
-/** the container structure for a node */
-typedef struct node Node;
+/** the weight reported for a pair of cities without an edge between them */
+#define NO_EDGE INT_MAX
 
 /** the container structure for a graph */
 typedef struct graph Graph;
 
+/** the ways in which a graph can be stored */
+typedef enum backend {
+	/** pick dense or sparse from the density of the edge list */
+	GRAPH_AUTO,
+	/** a row-major distance matrix */
+	GRAPH_DENSE,
+	/** compressed sparse rows of neighbours and weights */
+	GRAPH_SPARSE
+} Backend;
+
+/** a cursor over the cities adjacent to a city, so that several searches can
+ * walk the graph at the same time */
+typedef struct adj_iter {
+	/** the neighbours in the row being walked, or NULL for a matrix row */
+	const int *dests;
+	/** the weights in the row being walked */
+	const int *dists;
+	/** index of the next entry in the row */
+	int next;
+	/** number of entries in the row */
+	int end;
+} Adj_iter;
+
 /*--- function prototypes ----------------------------------------------------*/
 
 /**
- * Scan a weighted undirected graph from standard in and return its adjacency
- * list representation.
+ * Scan a weighted undirected graph from standard in and return its contiguous
+ * representation, picking the backend from the graph's density.
  *
  * @return      a pointer to the graph allocated
  */
@@ -31,6 +56,7 @@ Graph *scan_graph();
  * by the edges array (edges[i][0] is connected to edges[i][1] with weight
  * edges[i][2]). Added because it will be much easier to send an array to a
  * process that they can build the graph with than the graph structure itself.
+ * The backend is picked from the graph's density.
  *
  * @param[in]   v
  *     the number of vertices in the graph
@@ -38,25 +64,228 @@ Graph *scan_graph();
  *     the number of edges in the graph
  * @param[in]   edges
  *     an array of edges and edge weights
- * @return      an adjacency list representation of the specified graph
+ * @return      a contiguous representation of the specified graph
  */
 Graph *build_graph(int v, int e, int **edges);
 
+/**
+ * Like build_graph, but stores the graph with the specified backend. Dense
+ * graphs are stored as a distance matrix and sparse graphs as compressed sparse
+ * rows; in both cases every row starts on a cache line.
+ *
+ * @param[in]   v
+ *     the number of vertices in the graph
+ * @param[in]   e
+ *     the number of edges in the graph
+ * @param[in]   edges
+ *     an array of edges and edge weights
+ * @param[in]   backend
+ *     how the graph should be stored, or GRAPH_AUTO to decide from its density
+ * @return      a contiguous representation of the specified graph
+ */
+Graph *build_graph_backend(int v, int e, int **edges, Backend backend);
+
+/**
+ * Like build_graph, but reads each edge as an arc, so that edges[i][0] is only
+ * joined to edges[i][1] in that direction. The graph is treated as undirected
+ * after all if every arc is matched by one of the same weight the other way.
+ *
+ * @param[in]   v
+ *     the number of vertices in the graph
+ * @param[in]   e
+ *     the number of arcs in the graph
+ * @param[in]   edges
+ *     an array of arcs and arc weights
+ * @return      a contiguous representation of the specified graph
+ */
+Graph *build_directed_graph(int v, int e, int **edges);
+
+/**
+ * Allocates and returns a dense graph with v vertices from a row-major v by v
+ * distance matrix, in which NO_EDGE marks a missing edge. Unless the graph is
+ * directed, the cheaper of the two directions is kept for each pair of cities.
+ * The diagonal is ignored.
+ *
+ * @param[in]   v
+ *     the number of vertices in the graph
+ * @param[in]   matrix
+ *     the distances between every pair of vertices
+ * @param[in]   directed
+ *     whether matrix[from * v + to] only applies from from to to
+ * @return      a contiguous representation of the specified graph
+ */
+Graph *build_graph_matrix(int v, const int *matrix, Boolean directed);
+
+/**
+ * Allocates and returns a complete dense graph with v vertices, calling
+ * distance once for each pair of vertices to fill in the weight of the edge
+ * between them, so that no edge list or matrix need be built first.
+ *
+ * @param[in]   v
+ *     the number of vertices in the graph
+ * @param[in]   distance
+ *     returns the weight of the edge between two vertices, given data first
+ * @param[in]   data
+ *     passed on to every call of distance
+ * @return      a contiguous representation of the specified graph
+ */
+Graph *build_graph_function(int v, int (*distance)(void *, int, int),
+		void *data);
+
+/**
+ * Returns the backend the graph is stored with, which is never GRAPH_AUTO.
+ *
+ * @param[in]   graph
+ *     a pointer to the graph
+ * @return      GRAPH_DENSE or GRAPH_SPARSE
+ */
+Backend graph_backend(Graph *graph);
+
+/**
+ * Returns whether the graph is directed, so that a tour may cost something
+ * different, or be impossible, when it is walked the other way round. Every
+ * graph built from an undirected edge list or a symmetric matrix is not, nor is
+ * a directed one whose every arc has an equal arc the other way.
+ *
+ * @param[in]   graph
+ *     a pointer to the graph
+ * @return      true if the graph is directed, else false
+ */
+Boolean graph_directed(Graph *graph);
+
 /**
  * If there is a another node adjacent to city, read its destination into
- * neighbour and distance to it into cost.
+ * neighbour and distance to it into cost. Pass city on the first call to start
+ * walking its neighbours, and NULL on later calls to carry on from where iter
+ * left off. Separate iterators may be used from separate threads.
  *
  * @param[in]   graph
  *     a pointer to the underlying graph
+ * @param[in,out] iter
+ *     the cursor recording how far through the neighbours we are
  * @param[in]   city
- *     the city whose neighbours we would like to visit
+ *     the city whose neighbours we would like to visit, or NULL to continue
  * @param[out]  neighbour
  *     the next neighbour of specified city
  * @param[out]  cost
  *     the weight of the edge between the city and its next neighbour
  * @return      true if a neighbour was visited, else false
  */
-Boolean adj(Graph *graph, int *city, int *neighbour, int *cost);
+Boolean adj(Graph *graph, Adj_iter *iter, int *city, int *neighbour,
+		int *cost);
+
+/**
+ * Returns the weight of the edge from one city to another.
+ *
+ * @param[in]   graph
+ *     a pointer to the underlying graph
+ * @param[in]   from
+ *     the city the edge starts at
+ * @param[in]   to
+ *     the city the edge ends at
+ * @return      the weight of the edge, or NO_EDGE if there is none
+ */
+int edge_weight(Graph *graph, int from, int to);
+
+/**
+ * Changes the weight of the edge between two cities, in both directions
+ * unless the graph is directed, so that the same graph can be searched again
+ * after small changes. Weighting an edge NO_EDGE removes it. The cost ordered
+ * neighbours and cheapest edges of the cities at its ends are kept up to date,
+ * without sorting the other cities again. A new neighbour goes in the padding
+ * of a city's row in a sparse graph, and a row without any left is given more,
+ * which moves the rows after it. A directed graph stays directed even if the
+ * change makes it symmetric. Must not be called while the graph is being
+ * searched.
+ *
+ * @param[in]   graph
+ *     a pointer to the graph
+ * @param[in]   from
+ *     the city the edge starts at
+ * @param[in]   to
+ *     the city the edge ends at
+ * @param[in]   weight
+ *     the new weight of the edge, or NO_EDGE to remove it
+ * @return      true if the edge was changed, or false if it does not join two
+ *              distinct cities of the graph
+ */
+Boolean set_edge_weight(Graph *graph, int from, int to, int weight);
+
+/**
+ * Returns the row of the distance matrix of a dense graph, so that the weights
+ * of the edges from a city can be read without a call for each.
+ *
+ * @param[in]   graph
+ *     a pointer to the underlying graph
+ * @param[in]   city
+ *     the city the edges start at
+ * @return      the weights of the edges to every city, with NO_EDGE for the
+ *              city itself and those it is not adjacent to, or NULL if the
+ *              graph is sparse
+ */
+const int *graph_row(Graph *graph, int city);
+
+/**
+ * Returns the weight of the cheapest edge incident on the specified city, or
+ * leaving it if the graph is directed. This is computed when the graph is
+ * built.
+ *
+ * @param[in]   graph
+ *     a pointer to the underlying graph
+ * @param[in]   city
+ *     the city whose cheapest edge we would like
+ * @return      the weight of the cheapest edge, or 0 if city has no edges
+ */
+int min_edge(Graph *graph, int city);
+
+/**
+ * Returns the weight of the second cheapest edge incident on the specified
+ * city, where the two edges lead to different neighbours. This is computed when
+ * the graph is built.
+ *
+ * @param[in]   graph
+ *     a pointer to the underlying graph
+ * @param[in]   city
+ *     the city whose second cheapest edge we would like
+ * @return      the weight of the second cheapest edge, or 0 if city has fewer
+ *              than two edges
+ */
+int second_min_edge(Graph *graph, int city);
+
+/**
+ * Returns the neighbours of a city in order of the weight of the edge to them,
+ * cheapest first, with ties broken by neighbour. The lists are sorted when the
+ * graph is built and may be read from several threads at once.
+ *
+ * @param[in]   graph
+ *     a pointer to the underlying graph
+ * @param[in]   city
+ *     the city whose neighbours we would like
+ * @param[out]  neighbours
+ *     set to the sorted neighbours, unless NULL
+ * @param[out]  costs
+ *     set to the weights of the edges to the sorted neighbours, unless NULL
+ * @return      the number of neighbours, or 0 if city is not in the graph
+ */
+int neighbours_by_cost(Graph *graph, int city, const int **neighbours,
+		const int **costs);
+
+/**
+ * Returns the candidate list of a city: its k nearest neighbours, nearest
+ * first. Heuristics can restrict their moves to these.
+ *
+ * @param[in]   graph
+ *     a pointer to the underlying graph
+ * @param[in]   city
+ *     the city whose candidates we would like
+ * @param[in]   k
+ *     the most candidates wanted
+ * @param[out]  neighbours
+ *     set to the candidates
+ * @return      the number of candidates, which is less than k if the city has
+ *              fewer than k neighbours
+ */
+int candidates(Graph *graph, int city, int k, const int **neighbours);
 
 /**
  * Prints a graph to standard out.
@@ -0,0 +1,384 @@
+/**
+ * @file    heuristic.c
+ * @brief   Nearest neighbour and greedy edge tours, improved with 2-opt and
+ *          Or-opt moves.
+ * @author  L. Foxcroft
+ * @date    2022-06-17
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <mpi.h>
+#include "heuristic.h"
+
+/* the most starting cities nearest neighbour construction is tried from */
+#define MAX_STARTS 64
+/* the longest run of cities Or-opt tries to move */
+#define MAX_SEGMENT 3
+/* the length of a cyclic order of cities which is not a tour */
+#define NO_TOUR LONG_MAX
+
+/** an edge of the graph, used to build greedy tours */
+typedef struct edge {
+	int from;
+	int to;
+	int dist;
+} Edge;
+
+/*--- function prototypes ----------------------------------------------------*/
+
+static long nearest_neighbour(Graph *graph, int n, int start, int *order);
+static long greedy_edge(Graph *graph, int n, int *order);
+static long improve(Graph *graph, int n, int *order, long length);
+static Boolean two_opt(Graph *graph, int n, int *order, long *length);
+static Boolean or_opt(Graph *graph, int n, int *order, long *length,
+		int *scratch);
+static long tour_length(Graph *graph, int n, int *order);
+static int find_root(int *parent, int city);
+static int compare_edges(const void *a, const void *b);
+
+/*--- heuristic interface ----------------------------------------------------*/
+
+Partial_tour *warm_start(Graph *graph, int num_cities)
+{
+	int my_rank, comm_sz, starts, mine[2], best[2], *order, *best_order;
+	long length, best_length = NO_TOUR;
+	Partial_tour *tour;
+
+	MPI_Comm_rank(MPI_COMM_WORLD, &my_rank);
+	MPI_Comm_size(MPI_COMM_WORLD, &comm_sz);
+
+	order = (int *) malloc(sizeof(int) * (num_cities > 0 ? num_cities : 1));
+	best_order = (int *) malloc(sizeof(int) * (num_cities > 0 ? num_cities : 1));
+
+	/* tiny graphs are left to the exact search */
+	if (num_cities >= 3) {
+		/* deal the nearest neighbour starts, spread over the cities, and the
+		 * greedy tour (which counts as one more start) out to the processes.
+		 * Greedy edge joins paths either way round, so a directed graph does
+		 * without it. */
+		starts = (num_cities < MAX_STARTS) ? num_cities : MAX_STARTS;
+		for (int s = my_rank; s <= starts; s += comm_sz) {
+			if (s < starts) {
+				length = nearest_neighbour(graph, num_cities,
+						(int) ((long) s * num_cities / starts), order);
+			} else if (!graph_directed(graph)) {
+				length = greedy_edge(graph, num_cities, order);
+			} else {
+				continue;
+			}
+			if (length == NO_TOUR) {
+				continue;
+			}
+			length = improve(graph, num_cities, order, length);
+			if (length < best_length) {
+				best_length = length;
+				memcpy(best_order, order, sizeof(int) * num_cities);
+			}
+		}
+	}
+
+	/* find the process with the shortest tour, which shares its order */
+	mine[0] = (best_length < INT_MAX) ? (int) best_length : INT_MAX;
+	mine[1] = my_rank;
+	MPI_Allreduce(mine, best, 1, MPI_2INT, MPI_MINLOC, MPI_COMM_WORLD);
+	if (best[0] == INT_MAX) {
+		tour = tour_init(num_cities);
+		add_city(tour, 0, INT_MAX); /* indicates no tour was found */
+	} else {
+		MPI_Bcast(best_order, num_cities, MPI_INT, best[1], MPI_COMM_WORLD);
+		tour = build_tour(graph, num_cities, best_order);
+	}
+
+	free(order);
+	free(best_order);
+
+	return tour;
+}
+
+Partial_tour *build_tour(Graph *graph, int num_cities, int *order)
+{
+	int start, city, prev;
+	Partial_tour *tour = tour_init(num_cities);
+
+	for (start = 0; order[start] != 0; start++);
+	add_city(tour, 0, 0);
+	prev = 0;
+	for (int i = 1; i <= num_cities; i++) {
+		city = order[(start + i) % num_cities];
+		add_city(tour, city, edge_weight(graph, prev, city));
+		prev = city;
+	}
+
+	return tour;
+}
+
+/*--- construction -----------------------------------------------------------*/
+
+/** Build a tour from start by always moving to the closest city which has not
+ * been visited, and return its length */
+static long nearest_neighbour(Graph *graph, int n, int start, int *order)
+{
+	int city, next, degree;
+	const int *neighbours;
+	Boolean *seen = (Boolean *) calloc(n, sizeof(Boolean));
+
+	order[0] = start;
+	seen[start] = TRUE;
+	for (int i = 1; i < n; i++) {
+		city = order[i-1];
+		next = -1;
+		degree = neighbours_by_cost(graph, city, &neighbours, NULL);
+		for (int j = 0; j < degree && next < 0; j++) {
+			if (!seen[neighbours[j]]) {
+				next = neighbours[j];
+			}
+		}
+		if (next < 0) {
+			free(seen);
+			return NO_TOUR;
+		}
+		order[i] = next;
+		seen[next] = TRUE;
+	}
+
+	free(seen);
+	return tour_length(graph, n, order);
+}
+
+/** Build a tour by adding the cheapest edges first, skipping any which would
+ * give a city three edges or close a cycle too early, and return its length */
+static long greedy_edge(Graph *graph, int n, int *order)
+{
+	int city, neighbour, cost, e = 0, added = 0, a, b, *degree, *parent, *link;
+	Adj_iter iter;
+	Boolean found;
+	Edge *edges;
+
+	/* list every edge once */
+	for (int i = 0; i < n; i++) {
+		city = i;
+		found = adj(graph, &iter, &city, &neighbour, &cost);
+		while (found) {
+			e += neighbour > i;
+			found = adj(graph, &iter, NULL, &neighbour, &cost);
+		}
+	}
+	edges = (Edge *) malloc(sizeof(Edge) * (e > 0 ? e : 1));
+	e = 0;
+	for (int i = 0; i < n; i++) {
+		city = i;
+		found = adj(graph, &iter, &city, &neighbour, &cost);
+		while (found) {
+			if (neighbour > i) {
+				edges[e].from = i;
+				edges[e].to = neighbour;
+				edges[e++].dist = cost;
+			}
+			found = adj(graph, &iter, NULL, &neighbour, &cost);
+		}
+	}
+	qsort(edges, e, sizeof(Edge), compare_edges);
+
+	/* grow a set of paths, keeping both neighbours of every city in link */
+	degree = (int *) calloc(n, sizeof(int));
+	parent = (int *) malloc(sizeof(int) * n);
+	link = (int *) malloc(sizeof(int) * 2 * n);
+	for (int i = 0; i < n; i++) {
+		parent[i] = i;
+	}
+	for (int i = 0; i < e && added < n - 1; i++) {
+		a = edges[i].from;
+		b = edges[i].to;
+		if (degree[a] == 2 || degree[b] == 2
+				|| find_root(parent, a) == find_root(parent, b)) {
+			continue;
+		}
+		parent[find_root(parent, a)] = find_root(parent, b);
+		link[2*a + degree[a]++] = b;
+		link[2*b + degree[b]++] = a;
+		added++;
+	}
+
+	/* walk the path from one of its ends */
+	if (added == n - 1) {
+		for (a = 0; degree[a] != 1; a++);
+		order[0] = a;
+		order[1] = link[2*a];
+		for (int i = 2; i < n; i++) {
+			b = order[i-1];
+			order[i] = (link[2*b] == order[i-2]) ? link[2*b + 1] : link[2*b];
+		}
+	}
+
+	free(edges);
+	free(degree);
+	free(parent);
+	free(link);
+
+	return (added == n - 1) ? tour_length(graph, n, order) : NO_TOUR;
+}
+
+/*--- local search -----------------------------------------------------------*/
+
+/** Apply 2-opt and Or-opt moves until neither can shorten the tour, and return
+ * its new length. 2-opt reverses a path, so a directed graph only gets Or-opt
+ * moves. */
+static long improve(Graph *graph, int n, int *order, long length)
+{
+	Boolean improved;
+	int *scratch = (int *) malloc(sizeof(int) * n);
+
+	do {
+		improved = !graph_directed(graph)
+			&& two_opt(graph, n, order, &length);
+		improved = or_opt(graph, n, order, &length, scratch) || improved;
+	} while (improved);
+
+	free(scratch);
+	return length;
+}
+
+/** Replace pairs of edges (a, b) and (c, d) with (a, c) and (b, d) by
+ * reversing the path from b to c, whenever that is shorter. Return whether the
+ * tour was changed. */
+static Boolean two_opt(Graph *graph, int n, int *order, long *length)
+{
+	int a, b, c, d, ac, bd, swap;
+	long delta;
+	Boolean improved = FALSE;
+
+	for (int i = 0; i < n - 2; i++) {
+		for (int j = i + 2; j < n; j++) {
+			if (i == 0 && j == n - 1) {
+				continue; /* the two edges share city a */
+			}
+			a = order[i];
+			b = order[i+1];
+			c = order[j];
+			d = order[(j+1) % n];
+			ac = edge_weight(graph, a, c);
+			bd = edge_weight(graph, b, d);
+			if (ac == NO_EDGE || bd == NO_EDGE) {
+				continue;
+			}
+			delta = (long) ac + bd - edge_weight(graph, a, b)
+				- edge_weight(graph, c, d);
+			if (delta < 0) {
+				for (int lo = i + 1, hi = j; lo < hi; lo++, hi--) {
+					swap = order[lo];
+					order[lo] = order[hi];
+					order[hi] = swap;
+				}
+				*length += delta;
+				improved = TRUE;
+			}
+		}
+	}
+
+	return improved;
+}
+
+/** Move runs of up to MAX_SEGMENT cities to between two other neighbouring
+ * cities, either way round (or only the same way round if the graph is
+ * directed), whenever that is shorter. Return whether the tour was changed. */
+static Boolean or_opt(Graph *graph, int n, int *order, long *length,
+		int *scratch)
+{
+	int p, q, first, last, c, d, pq, forward, backward, k;
+	long removed, added;
+	Boolean improved = FALSE, reverse, directed = graph_directed(graph);
+
+	for (int len = 1; len <= MAX_SEGMENT && len + 3 <= n; len++) {
+		for (int i = 0; i < n; i++) {
+			/* take the segment from first to last out from between p and q */
+			p = order[(i + n - 1) % n];
+			first = order[i];
+			last = order[(i + len - 1) % n];
+			q = order[(i + len) % n];
+			pq = edge_weight(graph, p, q);
+			if (pq == NO_EDGE) {
+				continue;
+			}
+			removed = (long) edge_weight(graph, p, first)
+				+ edge_weight(graph, last, q) - pq;
+
+			/* and try putting it between each pair of cities c and d left */
+			for (int j = 0; j < n - len - 1; j++) {
+				c = order[(i + len + j) % n];
+				d = order[(i + len + j + 1) % n];
+				forward = (edge_weight(graph, c, first) == NO_EDGE
+						|| edge_weight(graph, last, d) == NO_EDGE) ? NO_EDGE
+					: edge_weight(graph, c, first) + edge_weight(graph, last, d);
+				backward = (directed || edge_weight(graph, c, last) == NO_EDGE
+						|| edge_weight(graph, first, d) == NO_EDGE) ? NO_EDGE
+					: edge_weight(graph, c, last) + edge_weight(graph, first, d);
+				reverse = backward < forward;
+				added = (long) (reverse ? backward : forward)
+					- edge_weight(graph, c, d);
+				if ((reverse ? backward : forward) == NO_EDGE
+						|| added >= removed) {
+					continue;
+				}
+
+				/* rebuild the order from q, dropping the segment in after c */
+				k = 0;
+				for (int m = 0; m < n - len; m++) {
+					scratch[k++] = order[(i + len + m) % n];
+					if (m == j) {
+						for (int s = 0; s < len; s++) {
+							scratch[k++] = reverse
+								? order[(i + len - 1 - s) % n]
+								: order[(i + s) % n];
+						}
+					}
+				}
+				memcpy(order, scratch, sizeof(int) * n);
+				*length += added - removed;
+				improved = TRUE;
+				break;
+			}
+		}
+	}
+
+	return improved;
+}
+
+/*--- utility functions ------------------------------------------------------*/
+
+/** Return the length of the cyclic order of cities, or NO_TOUR if a pair of
+ * neighbouring cities is not joined by an edge */
+static long tour_length(Graph *graph, int n, int *order)
+{
+	int weight;
+	long length = 0;
+
+	for (int i = 0; i < n; i++) {
+		weight = edge_weight(graph, order[i], order[(i+1) % n]);
+		if (weight == NO_EDGE) {
+			return NO_TOUR;
+		}
+		length += weight;
+	}
+
+	return length;
+}
+
+/** Return the representative of the set of paths city belongs to, halving the
+ * path to it as we go */
+static int find_root(int *parent, int city)
+{
+	while (parent[city] != city) {
+		parent[city] = parent[parent[city]];
+		city = parent[city];
+	}
+	return city;
+}
+
+/** Order edges by weight */
+static int compare_edges(const void *a, const void *b)
+{
+	int x = ((const Edge *) a)->dist, y = ((const Edge *) b)->dist;
+	return (x > y) - (x < y);
+}
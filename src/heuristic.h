@@ -0,0 +1,50 @@
+/**
+ * @file    heuristic.h
+ * @brief   Construction and local search heuristics which find a good tour to
+ *          start the exact search from.
+ * @author  L. Foxcroft
+ * @date    2022-06-17
+ */
+
+#ifndef HEURISTIC_H
+#define HEURISTIC_H
+
+#include "graph.h"
+#include "stack.h"
+
+/*--- function prototypes ----------------------------------------------------*/
+
+/**
+ * Finds a good tour quickly, so that the exact search can prune from the start
+ * rather than only once it happens upon its first complete tour. Tours are
+ * built with nearest neighbour construction from a spread of starting cities,
+ * which are shared out between the processes, and with greedy edge
+ * construction, and each is improved with 2-opt and Or-opt moves. A directed
+ * graph only gets the nearest neighbour tours and the Or-opt moves which keep
+ * every path the same way round. Every process in MPI_COMM_WORLD should call
+ * this at the same time.
+ *
+ * @param[in]   graph
+ *     a pointer to the graph to find a tour of
+ * @param[in]   num_cities
+ *     the number of cities in the graph
+ * @return      the best tour found by any process, which is the same on every
+ *              process and has a cost of INT_MAX if none was found
+ */
+Partial_tour *warm_start(Graph *graph, int num_cities);
+
+/**
+ * Turns a cyclic order of all the cities into a tour which starts and ends at
+ * city 0.
+ *
+ * @param[in]   graph
+ *     a pointer to the graph the order is a tour of
+ * @param[in]   num_cities
+ *     the number of cities in the graph
+ * @param[in]   order
+ *     an array of num_cities cities, in the order they are visited
+ * @return      the tour
+ */
+Partial_tour *build_tour(Graph *graph, int num_cities, int *order);
+
+#endif /* HEURISTIC_H */
@@ -0,0 +1,691 @@
+/**
+ * @file    instance.c
+ * @brief   A hand written parser for the text edge list and TSPLIB files, and
+ *          a binary instance format which is memory mapped by every process.
+ * @author  L. Foxcroft
+ * @date    2022-06-20
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "instance.h"
+
+/* the first two ints of every binary instance */
+#define MAGIC   0x42505354 /* "TSPB" */
+#define VERSION 1
+/* the number of ints in the header: magic, version, kind, cities, edges */
+#define HEADER_SIZE 5
+/* the kinds of binary instance */
+#define KIND_EDGES      0
+#define KIND_MATRIX     1
+#define KIND_ARCS       2
+#define KIND_ARC_MATRIX 3
+/* the number of bytes of text read at a time */
+#define BLOCK_SIZE (1 << 20)
+/* the longest TSPLIB keyword or value kept, including the terminator */
+#define WORD_SIZE 64
+/* the value of pi and the radius of the earth which TSPLIB's GEO metric uses */
+#define GEO_PI     3.141592
+#define GEO_RADIUS 6378.388
+
+/** a binary instance container */
+struct instance {
+	/** the mapped file, starting with the header */
+	int *data;
+	/** the number of bytes mapped */
+	size_t bytes;
+	/** KIND_EDGES, KIND_MATRIX, or KIND_ARCS or KIND_ARC_MATRIX if it is
+	 * directed */
+	int kind;
+	/** the number of cities */
+	int cities;
+	/** the number of edges */
+	int edges;
+};
+
+/** the shapes an explicit TSPLIB matrix can be given in */
+typedef enum shape {
+	/** every entry */
+	SHAPE_FULL,
+	/** the entries above the diagonal */
+	SHAPE_UPPER,
+	/** the entries below the diagonal */
+	SHAPE_LOWER,
+	/** the entries on and above the diagonal */
+	SHAPE_UPPER_DIAG,
+	/** the entries on and below the diagonal */
+	SHAPE_LOWER_DIAG
+} Shape;
+
+/** a buffered reader of text */
+typedef struct reader {
+	/** the file being read */
+	FILE *file;
+	/** the block of text read last */
+	char *buffer;
+	/** the position of the next character in the buffer */
+	size_t next;
+	/** the number of characters in the buffer */
+	size_t end;
+} Reader;
+
+/*--- function prototypes ----------------------------------------------------*/
+
+static Boolean scan_edges(Reader *reader, int *v, int *e, int ***edges);
+static Boolean scan_tsplib(Reader *reader, int *v, int *e, int ***edges,
+		Points **points, Boolean *directed);
+static Boolean scan_weights(Reader *reader, int v, const char *format, int *e,
+		int ***edges);
+static Boolean scan_value(Reader *reader, char *key, char *value);
+static Boolean next_int(Reader *reader, int *value);
+static Boolean next_double(Reader *reader, double *value);
+static Boolean next_word(Reader *reader, char *word);
+static void skip_space(Reader *reader);
+static void skip_line(Reader *reader);
+static int peek(Reader *reader);
+static int distance(void *points, int from, int to);
+static double geo_radians(double coordinate);
+static int nint(double x);
+static Boolean write_ints(FILE *file, const int *ints, size_t count);
+
+/*--- instance interface -----------------------------------------------------*/
+
+int **init_edge_list(int e)
+{
+	int **edges = (int **) malloc(sizeof(int *) * (e > 0 ? e : 1));
+	int *block = (int *) malloc(sizeof(int) * 3 * (e > 0 ? e : 1));
+	for (int i = 0; i < e; i++) {
+		edges[i] = block + 3 * i;
+	}
+	edges[0] = block;
+	return edges;
+}
+
+Boolean scan_instance(FILE *file, int *v, int *e, int ***edges,
+		Points **points, Boolean *directed)
+{
+	Reader reader;
+	Boolean ok;
+
+	reader.file = file;
+	reader.buffer = (char *) malloc(BLOCK_SIZE);
+	reader.next = 0;
+	reader.end = 0;
+
+	/* TSPLIB files start with a keyword, and edge lists with a number */
+	*points = NULL;
+	*directed = FALSE;
+	skip_space(&reader);
+	if (isalpha(peek(&reader))) {
+		ok = scan_tsplib(&reader, v, e, edges, points, directed);
+	} else {
+		ok = scan_edges(&reader, v, e, edges);
+	}
+
+	free(reader.buffer);
+
+	return ok;
+}
+
+Boolean write_instance(FILE *file, int v, int e, int **edges, Boolean matrix,
+		Boolean directed)
+{
+	int header[HEADER_SIZE], *distances, from, to, present = 0;
+	long cells = (long) v * v;
+	Boolean ok;
+
+	header[0] = MAGIC;
+	header[1] = VERSION;
+	if (directed) {
+		header[2] = matrix ? KIND_ARC_MATRIX : KIND_ARCS;
+	} else {
+		header[2] = matrix ? KIND_MATRIX : KIND_EDGES;
+	}
+	header[3] = v;
+	header[4] = e;
+
+	if (!matrix) {
+		ok = write_ints(file, header, HEADER_SIZE);
+		for (int i = 0; ok && i < e; i++) {
+			ok = write_ints(file, edges[i], 3);
+		}
+		return ok;
+	}
+
+	/* keep the cheapest edge between each pair of cities, in both directions
+	 * unless they are arcs */
+	distances = (int *) malloc(sizeof(int) * (cells > 0 ? cells : 1));
+	for (long k = 0; k < cells; k++) {
+		distances[k] = NO_EDGE;
+	}
+	for (int i = 0; i < e; i++) {
+		from = edges[i][0];
+		to = edges[i][1];
+		if (from < 0 || from >= v || to < 0 || to >= v || from == to) {
+			continue;
+		}
+		if (edges[i][2] < distances[(long) from * v + to]) {
+			present += distances[(long) from * v + to] == NO_EDGE;
+			distances[(long) from * v + to] = edges[i][2];
+			if (!directed) {
+				distances[(long) to * v + from] = edges[i][2];
+			}
+		}
+	}
+	header[4] = present;
+
+	ok = write_ints(file, header, HEADER_SIZE)
+		&& write_ints(file, distances, cells);
+	free(distances);
+
+	return ok;
+}
+
+Boolean write_points(FILE *file, Points *points)
+{
+	int header[HEADER_SIZE], v = points->count;
+	int *row = (int *) malloc(sizeof(int) * (v > 0 ? v : 1));
+	Boolean ok;
+
+	header[0] = MAGIC;
+	header[1] = VERSION;
+	header[2] = KIND_MATRIX;
+	header[3] = v;
+	header[4] = (int) ((long) v * (v - 1) / 2);
+
+	ok = write_ints(file, header, HEADER_SIZE);
+	for (int from = 0; ok && from < v; from++) {
+		for (int to = 0; to < v; to++) {
+			row[to] = (to == from) ? NO_EDGE : point_distance(points, from, to);
+		}
+		ok = write_ints(file, row, v);
+	}
+	free(row);
+
+	return ok;
+}
+
+Instance *map_instance(const char *path)
+{
+	int fd = open(path, O_RDONLY), *data;
+	struct stat info;
+	long expected;
+	Instance *instance;
+
+	if (fd < 0) {
+		return NULL;
+	}
+	if (fstat(fd, &info) != 0
+			|| info.st_size < (off_t) (sizeof(int) * HEADER_SIZE)) {
+		close(fd);
+		return NULL;
+	}
+	data = (int *) mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED) {
+		return NULL;
+	}
+
+	/* check the header and that the file holds exactly what it describes */
+	expected = -1;
+	if (data[0] == MAGIC && data[1] == VERSION && data[3] >= 0
+			&& data[4] >= 0) {
+		if (data[2] == KIND_EDGES || data[2] == KIND_ARCS) {
+			expected = HEADER_SIZE + 3L * data[4];
+		} else if (data[2] == KIND_MATRIX || data[2] == KIND_ARC_MATRIX) {
+			expected = HEADER_SIZE + (long) data[3] * data[3];
+		}
+	}
+	if (expected < 0 || (long) sizeof(int) * expected != (long) info.st_size) {
+		munmap(data, info.st_size);
+		return NULL;
+	}
+	madvise(data, info.st_size, MADV_SEQUENTIAL);
+
+	instance = (Instance *) malloc(sizeof(Instance));
+	instance->data = data;
+	instance->bytes = info.st_size;
+	instance->kind = data[2];
+	instance->cities = data[3];
+	instance->edges = data[4];
+
+	return instance;
+}
+
+int instance_cities(Instance *instance)
+{
+	return instance->cities;
+}
+
+Boolean instance_directed(Instance *instance)
+{
+	return instance->kind == KIND_ARCS || instance->kind == KIND_ARC_MATRIX;
+}
+
+Graph *instance_graph(Instance *instance)
+{
+	int **edges, *block = instance->data + HEADER_SIZE;
+	Graph *graph;
+
+	if (instance->kind == KIND_MATRIX || instance->kind == KIND_ARC_MATRIX) {
+		return build_graph_matrix(instance->cities, block,
+				instance->kind == KIND_ARC_MATRIX);
+	}
+
+	/* point the edge list straight into the mapping */
+	edges = (int **) malloc(sizeof(int *) * (instance->edges > 0
+				? instance->edges : 1));
+	for (int i = 0; i < instance->edges; i++) {
+		edges[i] = block + 3L * i;
+	}
+	if (instance->kind == KIND_ARCS) {
+		graph = build_directed_graph(instance->cities, instance->edges, edges);
+	} else {
+		graph = build_graph(instance->cities, instance->edges, edges);
+	}
+	free(edges);
+
+	return graph;
+}
+
+void unmap_instance(Instance *instance)
+{
+	munmap(instance->data, instance->bytes);
+	free(instance);
+}
+
+Points *points_init(int count, Metric metric)
+{
+	Points *points = (Points *) malloc(sizeof(Points));
+
+	points->count = count;
+	points->metric = metric;
+	points->x = (double *) malloc(sizeof(double) * (count > 0 ? count : 1));
+	points->y = (double *) malloc(sizeof(double) * (count > 0 ? count : 1));
+
+	return points;
+}
+
+int point_distance(Points *points, int from, int to)
+{
+	double dx = points->x[from] - points->x[to];
+	double dy = points->y[from] - points->y[to];
+	double r, q1, q2, q3;
+	int t, u;
+
+	switch (points->metric) {
+		case METRIC_CEIL_2D:
+			return (int) ceil(sqrt(dx * dx + dy * dy));
+		case METRIC_ATT:
+			r = sqrt((dx * dx + dy * dy) / 10.0);
+			t = nint(r);
+			return (t < r) ? t + 1 : t;
+		case METRIC_GEO:
+			/* x is the latitude and y the longitude, in degrees and minutes */
+			q1 = cos(geo_radians(points->y[from]) - geo_radians(points->y[to]));
+			q2 = cos(geo_radians(points->x[from]) - geo_radians(points->x[to]));
+			q3 = cos(geo_radians(points->x[from]) + geo_radians(points->x[to]));
+			return (int) (GEO_RADIUS
+					* acos(0.5 * ((1.0 + q1) * q2 - (1.0 - q1) * q3)) + 1.0);
+		case METRIC_MAN_2D:
+			return nint(fabs(dx) + fabs(dy));
+		case METRIC_MAX_2D:
+			t = nint(fabs(dx));
+			u = nint(fabs(dy));
+			return (t > u) ? t : u;
+		default:
+			return nint(sqrt(dx * dx + dy * dy));
+	}
+}
+
+Graph *points_graph(Points *points)
+{
+	return build_graph_function(points->count, distance, points);
+}
+
+void free_points(Points *points)
+{
+	free(points->x);
+	free(points->y);
+	free(points);
+}
+
+void free_edge_list(int e, int **edges)
+{
+	(void) e;
+	free(edges[0]);
+	free(edges);
+}
+
+/*--- utility functions ------------------------------------------------------*/
+
+/** Read a text edge list: the number of vertices and edges, then a source,
+ * destination and weight for each edge */
+static Boolean scan_edges(Reader *reader, int *v, int *e, int ***edges)
+{
+	int claimed = 0, i;
+
+	*v = 0;
+	if (!next_int(reader, v) || !next_int(reader, &claimed) || claimed < 0) {
+		claimed = 0;
+	}
+	*edges = init_edge_list(claimed);
+	for (i = 0; i < claimed; i++) {
+		if (!next_int(reader, &(*edges)[i][0])
+				|| !next_int(reader, &(*edges)[i][1])
+				|| !next_int(reader, &(*edges)[i][2])) {
+			break;
+		}
+	}
+	*e = i;
+
+	return *v > 0 && i == claimed;
+}
+
+/** Read a TSPLIB instance, either into points if it is given by coordinates
+ * or into an edge list if it is given by an explicit matrix, which is a list
+ * of arcs if the instance is asymmetric. Only the keywords and sections which
+ * describe the distances are used. */
+static Boolean scan_tsplib(Reader *reader, int *v, int *e, int ***edges,
+		Points **points, Boolean *directed)
+{
+	char key[WORD_SIZE], value[WORD_SIZE], format[WORD_SIZE] = "FULL_MATRIX";
+	int metric = -1, id;
+	double x, y;
+	Boolean ok = TRUE, explicit = FALSE;
+	static const char *metrics[] = {
+		"EUC_2D", "CEIL_2D", "ATT", "GEO", "MAN_2D", "MAX_2D"
+	};
+
+	*v = 0;
+	*e = 0;
+	*edges = NULL;
+	while (ok && next_word(reader, key) && strcmp(key, "EOF") != 0) {
+		if (strcmp(key, "NODE_COORD_SECTION") == 0) {
+			ok = *v > 0 && metric >= 0 && *points == NULL;
+			if (ok) {
+				*points = points_init(*v, (Metric) metric);
+			}
+			for (int i = 0; ok && i < *v; i++) {
+				ok = next_int(reader, &id) && next_double(reader, &x)
+					&& next_double(reader, &y) && id >= 1 && id <= *v;
+				if (ok) {
+					(*points)->x[id - 1] = x;
+					(*points)->y[id - 1] = y;
+				}
+			}
+		} else if (strcmp(key, "EDGE_WEIGHT_SECTION") == 0) {
+			ok = explicit && *v > 0 && *edges == NULL
+				&& scan_weights(reader, *v, format, e, edges);
+		} else if (strcmp(key, "DISPLAY_DATA_SECTION") == 0) {
+			for (int i = 0; ok && i < *v; i++) {
+				ok = next_int(reader, &id) && next_double(reader, &x)
+					&& next_double(reader, &y);
+			}
+		} else if (strcmp(key, "FIXED_EDGES_SECTION") == 0
+				|| strcmp(key, "TOUR_SECTION") == 0) {
+			/* lists of cities ending with -1 */
+			do {
+				ok = next_int(reader, &id);
+			} while (ok && id != -1);
+		} else if (!scan_value(reader, key, value)) {
+			/* NAME, COMMENT and the like, whose values may contain spaces */
+			skip_line(reader);
+		} else if (strcmp(key, "TYPE") == 0) {
+			*directed = strcmp(value, "ATSP") == 0;
+			ok = *directed || strcmp(value, "TSP") == 0;
+		} else if (strcmp(key, "DIMENSION") == 0) {
+			*v = atoi(value);
+			ok = *v > 0;
+		} else if (strcmp(key, "EDGE_WEIGHT_TYPE") == 0) {
+			explicit = strcmp(value, "EXPLICIT") == 0;
+			for (int i = 0; i < (int) (sizeof(metrics) / sizeof(metrics[0]));
+					i++) {
+				if (strcmp(value, metrics[i]) == 0) {
+					metric = i;
+				}
+			}
+			ok = explicit || metric >= 0;
+		} else if (strcmp(key, "EDGE_WEIGHT_FORMAT") == 0) {
+			strcpy(format, value);
+		}
+	}
+
+	/* asymmetric distances can only be given by a full matrix */
+	ok = ok && (explicit ? *edges != NULL : *points != NULL)
+		&& (!*directed || strcmp(format, "FULL_MATRIX") == 0);
+	if (!ok && *points != NULL) {
+		free_points(*points);
+		*points = NULL;
+	}
+	if (*edges == NULL) {
+		*edges = init_edge_list(0);
+		*e = 0;
+	}
+
+	return ok;
+}
+
+/** Read the weights of an explicit TSPLIB matrix given in the specified format
+ * into an edge list, leaving out the diagonal */
+static Boolean scan_weights(Reader *reader, int v, const char *format, int *e,
+		int ***edges)
+{
+	int first, last, weight;
+	long count = (long) v * (v - 1);
+	Shape shape;
+
+	if (strcmp(format, "FULL_MATRIX") == 0) {
+		shape = SHAPE_FULL;
+	} else if (strcmp(format, "UPPER_ROW") == 0
+			|| strcmp(format, "LOWER_COL") == 0) {
+		shape = SHAPE_UPPER;
+	} else if (strcmp(format, "LOWER_ROW") == 0
+			|| strcmp(format, "UPPER_COL") == 0) {
+		shape = SHAPE_LOWER;
+	} else if (strcmp(format, "UPPER_DIAG_ROW") == 0
+			|| strcmp(format, "LOWER_DIAG_COL") == 0) {
+		shape = SHAPE_UPPER_DIAG;
+	} else if (strcmp(format, "LOWER_DIAG_ROW") == 0
+			|| strcmp(format, "UPPER_DIAG_COL") == 0) {
+		shape = SHAPE_LOWER_DIAG;
+	} else {
+		return FALSE;
+	}
+	if (shape != SHAPE_FULL) {
+		count /= 2;
+	}
+	if (count > INT_MAX) {
+		return FALSE;
+	}
+
+	*edges = init_edge_list((int) count);
+	*e = 0;
+	for (int from = 0; from < v; from++) {
+		first = (shape == SHAPE_UPPER) ? from + 1
+			: (shape == SHAPE_UPPER_DIAG) ? from : 0;
+		last = (shape == SHAPE_LOWER) ? from - 1
+			: (shape == SHAPE_LOWER_DIAG) ? from : v - 1;
+		for (int to = first; to <= last; to++) {
+			if (!next_int(reader, &weight)) {
+				return FALSE;
+			}
+			if (to != from) {
+				(*edges)[*e][0] = from;
+				(*edges)[*e][1] = to;
+				(*edges)[(*e)++][2] = weight;
+			}
+		}
+	}
+
+	return TRUE;
+}
+
+/** Read the value of a TSPLIB keyword into value, splitting it from the key
+ * however the colon between them is spaced. Returns false, having read nothing
+ * more, if the key is not one whose value is used. */
+static Boolean scan_value(Reader *reader, char *key, char *value)
+{
+	char *colon = strchr(key, ':');
+	static const char *used[] = {
+		"TYPE", "DIMENSION", "EDGE_WEIGHT_TYPE", "EDGE_WEIGHT_FORMAT"
+	};
+	Boolean found = FALSE;
+
+	value[0] = '\0';
+	if (colon != NULL) {
+		*colon = '\0';
+		strcpy(value, colon + 1);
+	}
+	for (int i = 0; i < (int) (sizeof(used) / sizeof(used[0])); i++) {
+		found = found || strcmp(key, used[i]) == 0;
+	}
+	if (!found) {
+		return FALSE;
+	}
+
+	if (value[0] == '\0' && next_word(reader, value) && value[0] == ':') {
+		if (value[1] == '\0') {
+			next_word(reader, value);
+		} else {
+			memmove(value, value + 1, strlen(value));
+		}
+	}
+	skip_line(reader);
+
+	return TRUE;
+}
+
+/** Read the next whitespace separated int, returning false at the end of the
+ * file or if the next word is not a number */
+static Boolean next_int(Reader *reader, int *value)
+{
+	int c = peek(reader), sign = 1;
+	long number = 0;
+	Boolean digits = FALSE;
+
+	while (c == ' ' || c == '\n' || c == '\t' || c == '\r') {
+		reader->next++;
+		c = peek(reader);
+	}
+	if (c == '-' || c == '+') {
+		sign = (c == '-') ? -1 : 1;
+		reader->next++;
+		c = peek(reader);
+	}
+	while (c >= '0' && c <= '9') {
+		number = number * 10 + (c - '0');
+		digits = TRUE;
+		reader->next++;
+		c = peek(reader);
+	}
+
+	*value = (int) (sign * number);
+	return digits;
+}
+
+/** Read the next whitespace separated floating point number */
+static Boolean next_double(Reader *reader, double *value)
+{
+	char word[WORD_SIZE], *end;
+
+	if (!next_word(reader, word)) {
+		return FALSE;
+	}
+	*value = strtod(word, &end);
+	return end != word && *end == '\0';
+}
+
+/** Read the next whitespace separated word, keeping as much of it as fits in
+ * WORD_SIZE characters, or return false at the end of the file */
+static Boolean next_word(Reader *reader, char *word)
+{
+	int c, length = 0;
+
+	skip_space(reader);
+	c = peek(reader);
+	while (c != EOF && !isspace(c)) {
+		if (length < WORD_SIZE - 1) {
+			word[length++] = (char) c;
+		}
+		reader->next++;
+		c = peek(reader);
+	}
+	word[length] = '\0';
+
+	return length > 0;
+}
+
+/** Skip over whitespace */
+static void skip_space(Reader *reader)
+{
+	int c = peek(reader);
+
+	while (c != EOF && isspace(c)) {
+		reader->next++;
+		c = peek(reader);
+	}
+}
+
+/** Skip to the start of the next line */
+static void skip_line(Reader *reader)
+{
+	int c = peek(reader);
+
+	while (c != EOF && c != '\n') {
+		reader->next++;
+		c = peek(reader);
+	}
+	if (c != EOF) {
+		reader->next++;
+	}
+}
+
+/** Return the next character without consuming it, reading another block once
+ * the buffer runs out, or EOF at the end of the file */
+static int peek(Reader *reader)
+{
+	if (reader->next == reader->end) {
+		reader->next = 0;
+		reader->end = fread(reader->buffer, 1, BLOCK_SIZE, reader->file);
+		if (reader->end == 0) {
+			return EOF;
+		}
+	}
+	return (unsigned char) reader->buffer[reader->next];
+}
+
+/** Return the distance between two points, for build_graph_function */
+static int distance(void *points, int from, int to)
+{
+	return point_distance((Points *) points, from, to);
+}
+
+/** Convert a TSPLIB GEO coordinate, whose integer part is degrees and whose
+ * fraction is minutes, into radians */
+static double geo_radians(double coordinate)
+{
+	int degrees = (int) coordinate;
+	double minutes = coordinate - degrees;
+
+	return GEO_PI * (degrees + 5.0 * minutes / 3.0) / 180.0;
+}
+
+/** Round to the nearest int, as TSPLIB does */
+static int nint(double x)
+{
+	return (int) (x + 0.5);
+}
+
+/** Write count ints to file, returning whether they were all written */
+static Boolean write_ints(FILE *file, const int *ints, size_t count)
+{
+	return fwrite(ints, sizeof(int), count, file) == count;
+}
@@ -0,0 +1,228 @@
+/**
+ * @file    instance.h
+ * @brief   Reading and writing problem instances, either as the text edge list
+ *          or a TSPLIB file on standard in, or as a binary file which is
+ *          memory mapped.
+ * @author  L. Foxcroft
+ * @date    2022-06-20
+ */
+
+#ifndef INSTANCE_H
+#define INSTANCE_H
+
+#include <stdio.h>
+#include "boolean.h"
+#include "graph.h"
+
+/** the container structure for a memory mapped binary instance */
+typedef struct instance Instance;
+
+/** the ways a TSPLIB instance computes distances from coordinates */
+typedef enum metric {
+	/** Euclidean distance rounded to the nearest int */
+	METRIC_EUC_2D,
+	/** Euclidean distance rounded up */
+	METRIC_CEIL_2D,
+	/** pseudo-Euclidean distance, as used by the att instances */
+	METRIC_ATT,
+	/** great circle distance between latitudes and longitudes */
+	METRIC_GEO,
+	/** Manhattan distance rounded to the nearest int */
+	METRIC_MAN_2D,
+	/** maximum of the distances along each axis */
+	METRIC_MAX_2D
+} Metric;
+
+/** the cities of a TSPLIB instance given by coordinates, which is all that
+ * needs to be shared between processes, since every distance is computed from
+ * them */
+typedef struct points {
+	/** the number of cities */
+	int count;
+	/** how distances are computed */
+	Metric metric;
+	/** the first coordinate of every city */
+	double *x;
+	/** the second coordinate of every city */
+	double *y;
+} Points;
+
+/*--- function prototypes ----------------------------------------------------*/
+
+/**
+ * Allocates an edge list with room for e edges. The edges are laid out
+ * contiguously from edges[0], so the whole list can be sent in one go.
+ *
+ * @param[in]   e
+ *     the number of edges
+ * @return      an array of e edges, each of which is a source, a destination
+ *              and a weight
+ */
+int **init_edge_list(int e);
+
+/**
+ * Reads a graph from file, either in the text format (the number of vertices
+ * and edges, then a source, destination and weight for each edge) or as a
+ * TSPLIB instance of type TSP or ATSP, whose cities are renumbered from 0. An
+ * explicit TSPLIB matrix is read into an edge list, which holds arcs if the
+ * instance is an ATSP, but an instance given by coordinates is read into
+ * points instead, so that the distances need never be written out as edges.
+ * The file is read in large blocks and parsed by hand, which is much quicker
+ * than scanf for big graphs, so nothing else should read from it afterwards.
+ *
+ * @param[in]   file
+ *     the file to read from, such as stdin
+ * @param[out]  v
+ *     the number of vertices
+ * @param[out]  e
+ *     the number of edges read, which is fewer than the file claims if it ends
+ *     early
+ * @param[out]  edges
+ *     the edge list, which should be freed with free_edge_list
+ * @param[out]  points
+ *     the coordinates of the cities, or NULL if the graph was given by edges
+ * @param[out]  directed
+ *     whether the edge list holds arcs, which is only ever set for an ATSP
+ * @return      true if the whole graph was read, else false
+ */
+Boolean scan_instance(FILE *file, int *v, int *e, int ***edges,
+		Points **points, Boolean *directed);
+
+/**
+ * Writes a graph to file in the binary format, either as an edge list or as a
+ * full distance matrix holding the cheapest edge between each pair of cities
+ * and NO_EDGE where there is none. A directed graph is marked as such, and its
+ * matrix holds the cheapest arc from each city to each other one. Ints are
+ * written in the byte order of this machine.
+ *
+ * @param[in]   file
+ *     the file to write to
+ * @param[in]   v
+ *     the number of vertices
+ * @param[in]   e
+ *     the number of edges
+ * @param[in]   edges
+ *     the edge list
+ * @param[in]   matrix
+ *     whether to write a distance matrix rather than an edge list
+ * @param[in]   directed
+ *     whether the edge list holds arcs
+ * @return      true if the graph was written, else false
+ */
+Boolean write_instance(FILE *file, int v, int e, int **edges, Boolean matrix,
+		Boolean directed);
+
+/**
+ * Writes the distances between a set of points to file as a binary distance
+ * matrix, computing one row at a time.
+ *
+ * @param[in]   file
+ *     the file to write to
+ * @param[in]   points
+ *     the coordinates of the cities
+ * @return      true if the matrix was written, else false
+ */
+Boolean write_points(FILE *file, Points *points);
+
+/**
+ * Maps a binary instance into memory, so that every process can read the
+ * graph straight from a file on shared storage rather than have it broadcast.
+ *
+ * @param[in]   path
+ *     the name of the binary file
+ * @return      a pointer to the mapped instance, or NULL if the file could not
+ *              be mapped or is not a binary instance
+ */
+Instance *map_instance(const char *path);
+
+/**
+ * Returns the number of cities in a mapped instance.
+ *
+ * @param[in]   instance
+ *     a pointer to the mapped instance
+ * @return      the number of cities
+ */
+int instance_cities(Instance *instance);
+
+/**
+ * Returns whether a mapped instance holds a directed graph.
+ *
+ * @param[in]   instance
+ *     a pointer to the mapped instance
+ * @return      true if the instance's arcs may cost differently each way
+ */
+Boolean instance_directed(Instance *instance);
+
+/**
+ * Builds a graph from a mapped instance. A distance matrix is copied into a
+ * dense graph row by row, without going through an edge list at all.
+ *
+ * @param[in]   instance
+ *     a pointer to the mapped instance
+ * @return      a contiguous representation of the instance's graph
+ */
+Graph *instance_graph(Instance *instance);
+
+/**
+ * Unmaps an instance. Graphs built from it are unaffected.
+ *
+ * @param[in]   instance
+ *     the instance to unmap
+ */
+void unmap_instance(Instance *instance);
+
+/**
+ * Allocates room for the coordinates of count cities, which are filled in by
+ * the caller.
+ *
+ * @param[in]   count
+ *     the number of cities
+ * @param[in]   metric
+ *     how distances between the cities are computed
+ * @return      a pointer to the points
+ */
+Points *points_init(int count, Metric metric);
+
+/**
+ * Returns the distance between two cities given by coordinates, as TSPLIB
+ * defines it for their metric.
+ *
+ * @param[in]   points
+ *     a pointer to the coordinates of the cities
+ * @param[in]   from
+ *     the first city
+ * @param[in]   to
+ *     the second city
+ * @return      the distance between them
+ */
+int point_distance(Points *points, int from, int to);
+
+/**
+ * Builds a dense graph from the coordinates of its cities, computing each
+ * distance straight into the distance matrix.
+ *
+ * @param[in]   points
+ *     a pointer to the coordinates of the cities
+ * @return      a contiguous representation of the complete graph
+ */
+Graph *points_graph(Points *points);
+
+/**
+ * Frees the space associated with a set of points.
+ *
+ * @param[in]   points
+ *     the points to free
+ */
+void free_points(Points *points);
+
+/**
+ * Frees the space associated with an edge list.
+ *
+ * @param[in]   e
+ *     the number of edges
+ * @param[in]   edges
+ *     the edge list to free
+ */
+void free_edge_list(int e, int **edges);
+
+#endif /* INSTANCE_H */
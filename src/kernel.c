@@ -0,0 +1,405 @@
+/**
+ * @file    kernel.c
+ * @brief   Scalar, AVX2 and AVX-512 versions of the inner loops of the lower
+ *          bounds. The vector versions are compiled for their instruction set
+ *          with target attributes, so that one binary runs everywhere.
+ * @author  L. Foxcroft
+ * @date    2022-06-21
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "graph.h"
+#include "kernel.h"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+	#define X86_KERNELS
+	#include <immintrin.h>
+#endif
+
+/* number of cities tracked by each word of a visited bitmask */
+#define WORD_BITS 64
+
+/*--- function prototypes ----------------------------------------------------*/
+
+static int prim_step_scalar(const int *row, const int *left, int k, int next,
+		const double *pi, const double *done, double *key, int *parent);
+static long masked_sum_scalar(const long *values, const uint64_t *visited,
+		int n);
+static int masked_min_scalar(const int *row, const uint64_t *visited, int n);
+static uint64_t unvisited_bits(const uint64_t *visited, int word, int n);
+
+#ifdef X86_KERNELS
+static int prim_step_avx2(const int *row, const int *left, int k, int next,
+		const double *pi, const double *done, double *key, int *parent);
+static long masked_sum_avx2(const long *values, const uint64_t *visited,
+		int n);
+static int masked_min_avx2(const int *row, const uint64_t *visited, int n);
+static int prim_step_avx512(const int *row, const int *left, int k, int next,
+		const double *pi, const double *done, double *key, int *parent);
+static long masked_sum_avx512(const long *values, const uint64_t *visited,
+		int n);
+static int masked_min_avx512(const int *row, const uint64_t *visited, int n);
+static void closest_lane(const double *least, const double *best, int lanes,
+		int *entry, double *key);
+#endif /* X86_KERNELS */
+
+/* every version of the kernels, fastest last */
+static const Kernels scalar_kernels = {
+	"scalar", prim_step_scalar, masked_sum_scalar, masked_min_scalar
+};
+#ifdef X86_KERNELS
+static const Kernels avx2_kernels = {
+	"avx2", prim_step_avx2, masked_sum_avx2, masked_min_avx2
+};
+static const Kernels avx512_kernels = {
+	"avx512", prim_step_avx512, masked_sum_avx512, masked_min_avx512
+};
+#endif /* X86_KERNELS */
+
+/*--- kernel interface -------------------------------------------------------*/
+
+const Kernels *select_kernels(void)
+{
+	const char *wanted = getenv("TSP_KERNEL");
+
+	if (wanted != NULL && strcmp(wanted, "scalar") == 0) {
+		return &scalar_kernels;
+	}
+#ifdef X86_KERNELS
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512vl")
+			&& (wanted == NULL || strcmp(wanted, "avx512") == 0)) {
+		return &avx512_kernels;
+	}
+	if (__builtin_cpu_supports("avx2")) {
+		return &avx2_kernels;
+	}
+#endif /* X86_KERNELS */
+	return &scalar_kernels;
+}
+
+/*--- scalar kernels ---------------------------------------------------------*/
+
+static int prim_step_scalar(const int *row, const int *left, int k, int next,
+		const double *pi, const double *done, double *key, int *parent)
+{
+	int weight, best = -1;
+	double cost, least = HUGE_VAL;
+
+	for (int i = 0; i < k; i++) {
+		weight = row[left[i]];
+		if (weight != NO_EDGE) {
+			cost = weight + pi[next] + pi[i] + done[i];
+			if (cost < key[i]) {
+				key[i] = cost;
+				parent[i] = next;
+			}
+		}
+		if (key[i] + done[i] < least) {
+			least = key[i] + done[i];
+			best = i;
+		}
+	}
+
+	return best;
+}
+
+static long masked_sum_scalar(const long *values, const uint64_t *visited,
+		int n)
+{
+	long sum = 0;
+	uint64_t bits;
+
+	for (int word = 0; word * WORD_BITS < n; word++) {
+		bits = unvisited_bits(visited, word, n);
+		while (bits != 0) {
+			sum += values[word * WORD_BITS + __builtin_ctzll(bits)];
+			bits &= bits - 1;
+		}
+	}
+
+	return sum;
+}
+
+static int masked_min_scalar(const int *row, const uint64_t *visited, int n)
+{
+	int least = NO_EDGE, weight;
+	uint64_t bits;
+
+	for (int word = 0; word * WORD_BITS < n; word++) {
+		bits = unvisited_bits(visited, word, n);
+		while (bits != 0) {
+			weight = row[word * WORD_BITS + __builtin_ctzll(bits)];
+			least = (weight < least) ? weight : least;
+			bits &= bits - 1;
+		}
+	}
+
+	return least;
+}
+
+/*--- AVX2 kernels -----------------------------------------------------------*/
+
+#ifdef X86_KERNELS
+
+/** Four entries at a time, gathering their weights from the row */
+__attribute__((target("avx2")))
+static int prim_step_avx2(const int *row, const int *left, int k, int next,
+		const double *pi, const double *done, double *key, int *parent)
+{
+	const __m256d infinity = _mm256_set1_pd(HUGE_VAL);
+	const __m256d penalty = _mm256_set1_pd(pi[next]);
+	const __m256d step = _mm256_set1_pd(4.0);
+	const __m256i halves = _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6);
+	const __m128i no_edge = _mm_set1_epi32(NO_EDGE);
+	const __m128i from = _mm_set1_epi32(next);
+	__m256d least = infinity, best = _mm256_set1_pd(-1.0);
+	__m256d index = _mm256_setr_pd(0.0, 1.0, 2.0, 3.0);
+	__m256d cost, keys, lower, missing, select, smaller;
+	__m128i weights, lower32;
+	double lanes[8], value;
+	int i, entry;
+
+	for (i = 0; i + 4 <= k; i += 4) {
+		weights = _mm_setr_epi32(row[left[i]], row[left[i + 1]],
+				row[left[i + 2]], row[left[i + 3]]);
+		missing = _mm256_castsi256_pd(_mm256_cvtepi32_epi64(
+					_mm_cmpeq_epi32(weights, no_edge)));
+		cost = _mm256_add_pd(_mm256_cvtepi32_pd(weights), penalty);
+		cost = _mm256_add_pd(cost, _mm256_loadu_pd(pi + i));
+		cost = _mm256_add_pd(cost, _mm256_loadu_pd(done + i));
+		cost = _mm256_blendv_pd(cost, infinity, missing);
+
+		/* take the cheaper edges, and next as their parent */
+		keys = _mm256_loadu_pd(key + i);
+		lower = _mm256_cmp_pd(cost, keys, _CMP_LT_OQ);
+		keys = _mm256_blendv_pd(keys, cost, lower);
+		_mm256_storeu_pd(key + i, keys);
+		lower32 = _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(
+					_mm256_castpd_si256(lower), halves));
+		_mm_storeu_si128((__m128i *) (parent + i), _mm_blendv_epi8(
+					_mm_loadu_si128((const __m128i *) (parent + i)), from,
+					lower32));
+
+		/* keep the first smallest key in each lane */
+		select = _mm256_add_pd(keys, _mm256_loadu_pd(done + i));
+		smaller = _mm256_cmp_pd(select, least, _CMP_LT_OQ);
+		least = _mm256_blendv_pd(least, select, smaller);
+		best = _mm256_blendv_pd(best, index, smaller);
+		index = _mm256_add_pd(index, step);
+	}
+	_mm256_storeu_pd(lanes, least);
+	_mm256_storeu_pd(lanes + 4, best);
+	closest_lane(lanes, lanes + 4, 4, &entry, &value);
+
+	/* later entries only win with a strictly smaller key */
+	for (; i < k; i++) {
+		if (row[left[i]] != NO_EDGE
+				&& row[left[i]] + pi[next] + pi[i] + done[i] < key[i]) {
+			key[i] = row[left[i]] + pi[next] + pi[i] + done[i];
+			parent[i] = next;
+		}
+		if (key[i] + done[i] < value) {
+			value = key[i] + done[i];
+			entry = i;
+		}
+	}
+
+	return entry;
+}
+
+/** Four values at a time, loading only the cities not visited */
+__attribute__((target("avx2")))
+static long masked_sum_avx2(const long *values, const uint64_t *visited,
+		int n)
+{
+	const __m256i bit = _mm256_setr_epi64x(1, 2, 4, 8);
+	__m256i sum = _mm256_setzero_si256(), mask;
+	long lanes[4];
+	uint64_t bits;
+
+	for (int word = 0; word * WORD_BITS < n; word++) {
+		bits = unvisited_bits(visited, word, n);
+		for (int i = 0; bits != 0; i += 4, bits >>= 4) {
+			if ((bits & 0xF) == 0) {
+				continue;
+			}
+			mask = _mm256_and_si256(_mm256_set1_epi64x(bits & 0xF), bit);
+			mask = _mm256_cmpeq_epi64(mask, bit);
+			sum = _mm256_add_epi64(sum, _mm256_maskload_epi64(
+						(const long long *) values + word * WORD_BITS + i,
+						mask));
+		}
+	}
+	_mm256_storeu_si256((__m256i *) lanes, sum);
+
+	return lanes[0] + lanes[1] + lanes[2] + lanes[3];
+}
+
+/** Eight entries at a time, loading only the cities not visited */
+__attribute__((target("avx2")))
+static int masked_min_avx2(const int *row, const uint64_t *visited, int n)
+{
+	const __m256i bit = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+	const __m256i none = _mm256_set1_epi32(NO_EDGE);
+	__m256i least = none, mask, weights;
+	int lanes[8], result = NO_EDGE;
+	uint64_t bits;
+
+	for (int word = 0; word * WORD_BITS < n; word++) {
+		bits = unvisited_bits(visited, word, n);
+		for (int i = 0; bits != 0; i += 8, bits >>= 8) {
+			if ((bits & 0xFF) == 0) {
+				continue;
+			}
+			mask = _mm256_and_si256(_mm256_set1_epi32((int) (bits & 0xFF)),
+					bit);
+			mask = _mm256_cmpeq_epi32(mask, bit);
+			weights = _mm256_maskload_epi32(row + word * WORD_BITS + i, mask);
+			least = _mm256_min_epi32(least,
+					_mm256_blendv_epi8(none, weights, mask));
+		}
+	}
+	_mm256_storeu_si256((__m256i *) lanes, least);
+	for (int i = 0; i < 8; i++) {
+		result = (lanes[i] < result) ? lanes[i] : result;
+	}
+
+	return result;
+}
+
+/*--- AVX-512 kernels --------------------------------------------------------*/
+
+/** Eight entries at a time, with mask registers in place of blends */
+__attribute__((target("avx2,avx512f,avx512vl")))
+static int prim_step_avx512(const int *row, const int *left, int k, int next,
+		const double *pi, const double *done, double *key, int *parent)
+{
+	const __m512d infinity = _mm512_set1_pd(HUGE_VAL);
+	const __m512d penalty = _mm512_set1_pd(pi[next]);
+	const __m512d step = _mm512_set1_pd(8.0);
+	const __m256i no_edge = _mm256_set1_epi32(NO_EDGE);
+	const __m256i from = _mm256_set1_epi32(next);
+	__m512d least = infinity, best = _mm512_set1_pd(-1.0);
+	__m512d index = _mm512_setr_pd(0.0, 1.0, 2.0, 3.0, 4.0, 5.0, 6.0, 7.0);
+	__m512d cost, keys, select;
+	__m256i weights;
+	__mmask8 present, lower, smaller;
+	double lanes[16], value;
+	int i, entry;
+
+	for (i = 0; i + 8 <= k; i += 8) {
+		weights = _mm256_i32gather_epi32(row,
+				_mm256_loadu_si256((const __m256i *) (left + i)), 4);
+		present = ~_mm256_cmpeq_epi32_mask(weights, no_edge);
+		cost = _mm512_add_pd(_mm512_cvtepi32_pd(weights), penalty);
+		cost = _mm512_add_pd(cost, _mm512_loadu_pd(pi + i));
+		cost = _mm512_add_pd(cost, _mm512_loadu_pd(done + i));
+
+		/* take the cheaper edges, and next as their parent */
+		keys = _mm512_loadu_pd(key + i);
+		lower = _mm512_mask_cmp_pd_mask(present, cost, keys, _CMP_LT_OQ);
+		keys = _mm512_mask_mov_pd(keys, lower, cost);
+		_mm512_storeu_pd(key + i, keys);
+		_mm256_mask_storeu_epi32(parent + i, lower, from);
+
+		/* keep the first smallest key in each lane */
+		select = _mm512_add_pd(keys, _mm512_loadu_pd(done + i));
+		smaller = _mm512_cmp_pd_mask(select, least, _CMP_LT_OQ);
+		least = _mm512_mask_mov_pd(least, smaller, select);
+		best = _mm512_mask_mov_pd(best, smaller, index);
+		index = _mm512_add_pd(index, step);
+	}
+	_mm512_storeu_pd(lanes, least);
+	_mm512_storeu_pd(lanes + 8, best);
+	closest_lane(lanes, lanes + 8, 8, &entry, &value);
+
+	/* later entries only win with a strictly smaller key */
+	for (; i < k; i++) {
+		if (row[left[i]] != NO_EDGE
+				&& row[left[i]] + pi[next] + pi[i] + done[i] < key[i]) {
+			key[i] = row[left[i]] + pi[next] + pi[i] + done[i];
+			parent[i] = next;
+		}
+		if (key[i] + done[i] < value) {
+			value = key[i] + done[i];
+			entry = i;
+		}
+	}
+
+	return entry;
+}
+
+/** Eight values at a time, each byte of the bitmask masking a load */
+__attribute__((target("avx512f")))
+static long masked_sum_avx512(const long *values, const uint64_t *visited,
+		int n)
+{
+	__m512i sum = _mm512_setzero_si512();
+	uint64_t bits;
+
+	for (int word = 0; word * WORD_BITS < n; word++) {
+		bits = unvisited_bits(visited, word, n);
+		for (int i = 0; bits != 0; i += 8, bits >>= 8) {
+			sum = _mm512_add_epi64(sum, _mm512_maskz_loadu_epi64(
+						(__mmask8) bits, values + word * WORD_BITS + i));
+		}
+	}
+
+	return _mm512_reduce_add_epi64(sum);
+}
+
+/** Sixteen entries at a time, each pair of bytes of the bitmask masking a
+ * load */
+__attribute__((target("avx512f")))
+static int masked_min_avx512(const int *row, const uint64_t *visited, int n)
+{
+	__m512i least = _mm512_set1_epi32(NO_EDGE);
+	uint64_t bits;
+
+	for (int word = 0; word * WORD_BITS < n; word++) {
+		bits = unvisited_bits(visited, word, n);
+		for (int i = 0; bits != 0; i += 16, bits >>= 16) {
+			least = _mm512_mask_min_epi32(least, (__mmask16) bits, least,
+					_mm512_maskz_loadu_epi32((__mmask16) bits,
+						row + word * WORD_BITS + i));
+		}
+	}
+
+	return _mm512_reduce_min_epi32(least);
+}
+
+/** Combine the smallest key kept by each lane into the first entry with the
+ * smallest key overall, or -1 if no lane found one */
+static void closest_lane(const double *least, const double *best, int lanes,
+		int *entry, double *key)
+{
+	*entry = -1;
+	*key = HUGE_VAL;
+	for (int lane = 0; lane < lanes; lane++) {
+		if (least[lane] < *key || (least[lane] == *key && *entry >= 0
+					&& least[lane] < HUGE_VAL && best[lane] < *entry)) {
+			*key = least[lane];
+			*entry = (int) best[lane];
+		}
+	}
+}
+
+#endif /* X86_KERNELS */
+
+/*--- utility functions ------------------------------------------------------*/
+
+/** Return the bits of a word of the visited bitmask standing for cities which
+ * are not visited, leaving out any past the first n */
+static uint64_t unvisited_bits(const uint64_t *visited, int word, int n)
+{
+	uint64_t bits = ~visited[word];
+	int rest = n - word * WORD_BITS;
+
+	if (rest < WORD_BITS) {
+		bits &= ((uint64_t) 1 << rest) - 1;
+	}
+	return bits;
+}
@@ -0,0 +1,88 @@
+/**
+ * @file    kernel.h
+ * @brief   The inner loops of the lower bounds over a distance matrix, in
+ *          scalar, AVX2 and AVX-512 versions picked at run time.
+ * @author  L. Foxcroft
+ * @date    2022-06-21
+ */
+
+#ifndef KERNEL_H
+#define KERNEL_H
+
+#include <stdint.h>
+
+/** one version of every kernel, all of which give exactly the same results */
+typedef struct kernels {
+	/** the name of the instruction set the kernels use */
+	const char *name;
+
+	/**
+	 * Carries out one step of Prim's algorithm over k cities, whose edges
+	 * are penalised by pi at both ends: the city next has just joined the
+	 * tree, so each city outside it whose key is beaten by its edge to next
+	 * takes that edge as its key and next as its parent. Cities in the tree
+	 * are those whose entry in done is HUGE_VAL rather than 0.
+	 *
+	 * @param[in]     row
+	 *     the row of the distance matrix of the city next stands for
+	 * @param[in]     left
+	 *     the city each of the k entries stands for
+	 * @param[in]     k
+	 *     the number of cities
+	 * @param[in]     next
+	 *     the entry which has just joined the tree
+	 * @param[in]     pi
+	 *     the penalty of each entry
+	 * @param[in]     done
+	 *     HUGE_VAL for each entry in the tree, else 0
+	 * @param[in,out] key
+	 *     the cheapest edge joining each entry to the tree
+	 * @param[in,out] parent
+	 *     the entry at the other end of each key
+	 * @return        the first entry outside the tree with the smallest key,
+	 *                or -1 if no entry outside the tree can be reached
+	 */
+	int (*prim_step)(const int *row, const int *left, int k, int next,
+			const double *pi, const double *done, double *key, int *parent);
+
+	/**
+	 * Sums values over the first n cities which are not marked in a visited
+	 * bitmask.
+	 *
+	 * @param[in]   values
+	 *     the value of each city
+	 * @param[in]   visited
+	 *     the visited bitmask of a partial tour
+	 * @param[in]   n
+	 *     the number of cities
+	 * @return      the sum of the values of the cities not visited
+	 */
+	long (*masked_sum)(const long *values, const uint64_t *visited, int n);
+
+	/**
+	 * Returns the smallest entry of a row of the distance matrix over the
+	 * first n cities which are not marked in a visited bitmask.
+	 *
+	 * @param[in]   row
+	 *     the row of the distance matrix
+	 * @param[in]   visited
+	 *     the visited bitmask of a partial tour
+	 * @param[in]   n
+	 *     the number of cities
+	 * @return      the smallest entry, or NO_EDGE if there is none
+	 */
+	int (*masked_min)(const int *row, const uint64_t *visited, int n);
+} Kernels;
+
+/*--- function prototypes ----------------------------------------------------*/
+
+/**
+ * Returns the fastest kernels this processor supports, unless the TSP_KERNEL
+ * environment variable names the ones to use instead (scalar, avx2 or avx512),
+ * which is handy for comparing them.
+ *
+ * @return      a pointer to the kernels
+ */
+const Kernels *select_kernels(void);
+
+#endif /* KERNEL_H */
@@ -0,0 +1,549 @@
+/**
+ * @file    lk.c
+ * @brief   Iterated Lin-Kernighan heuristic, with the processes swapping their
+ *          best tours every so often.
+ * @author  L. Foxcroft
+ * @date    2022-06-18
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <stdint.h>
+#include <mpi.h>
+#include "lk.h"
+#include "heuristic.h"
+
+/* the number of nearest neighbours each city considers new edges to */
+#define CANDIDATES 8
+/* the most 2-opt moves chained into one Lin-Kernighan move */
+#define MAX_DEPTH 50
+/* the number of kicks between swaps of the best tour */
+#define EXCHANGE_INTERVAL 50
+/* the most positions between the cuts of a double-bridge kick */
+#define KICK_SEGMENT 50
+/* the number of times to look for a kick which only uses edges of the graph */
+#define KICK_ATTEMPTS 10
+/* the length of an order of cities which is not a tour */
+#define NO_TOUR LONG_MAX
+
+/** the state of one process's local search */
+typedef struct lk {
+	/** the graph being toured */
+	Graph *graph;
+	/** the number of cities in the graph */
+	int n;
+	/** the weight given to pairs of cities without an edge, which is more than
+	 * any tour of real edges costs, so that the search can pass through them
+	 * on sparse graphs but will try to get rid of them */
+	long penalty;
+	/** the CANDIDATES nearest neighbours of each city, nearest first, padded
+	 * with -1 */
+	int *candidates;
+	/** the cities in tour order */
+	int *order;
+	/** the position of each city in order */
+	int *pos;
+	/** whether the tour runs backwards through order, so that the shorter side
+	 * of a 2-opt move can always be the one reversed */
+	Boolean reversed;
+	/** the length of the tour */
+	long length;
+	/** cities waiting to be improved from, in a circular buffer */
+	int *queue;
+	/** index of the first city in queue */
+	int head;
+	/** number of cities in queue */
+	int queued;
+	/** whether each city is in queue, the opposite of its don't-look bit */
+	Boolean *in_queue;
+	/** the 2-opt moves making up the current Lin-Kernighan move, as pairs of
+	 * cities */
+	int *moves;
+	/** the number of moves made */
+	int num_moves;
+	/** scratch space for rearranging the tour */
+	int *scratch;
+	/** state of the random number generator */
+	uint64_t random;
+} Lk;
+
+/* how many neighbours to try at each depth of a move, after which only the
+ * nearest is tried */
+static const int breadth[] = {5, 3};
+
+/*--- function prototypes ----------------------------------------------------*/
+
+static Partial_tour *only_tour(Graph *graph, int num_cities);
+static Lk *lk_init(Graph *graph, int num_cities, int seed);
+static void lk_free(Lk *lk);
+static void find_candidates(Lk *lk);
+static void first_tour(Lk *lk);
+static void optimise(Lk *lk);
+static long improve_from(Lk *lk, int t1, int t2, long gain, int depth);
+static Boolean kick(Lk *lk);
+static long weight(Lk *lk, int a, int b);
+static void flip(Lk *lk, int a, int b);
+static int succ(Lk *lk, int city);
+static int pred(Lk *lk, int city);
+static void push(Lk *lk, int city);
+static void normalise(Lk *lk);
+static void set_order(Lk *lk, int *order, long length);
+static void exchange(Lk *lk, int *best, long *best_length);
+static int random_below(Lk *lk, int bound);
+
+/*--- lin-kernighan interface ------------------------------------------------*/
+
+Partial_tour *lin_kernighan(Graph *graph, int num_cities, int kicks)
+{
+	int my_rank, *best;
+	long best_length = NO_TOUR;
+	Lk *lk;
+	Partial_tour *tour;
+
+	/* there is only one tour of three cities or fewer, so there is nothing to
+	 * improve */
+	if (num_cities <= 3) {
+		return only_tour(graph, num_cities);
+	}
+
+	MPI_Comm_rank(MPI_COMM_WORLD, &my_rank);
+	lk = lk_init(graph, num_cities, my_rank);
+	best = (int *) malloc(sizeof(int) * (num_cities > 0 ? num_cities : 1));
+
+	/* every process starts from a different random city */
+	first_tour(lk);
+	optimise(lk);
+	normalise(lk);
+	best_length = lk->length;
+	memcpy(best, lk->order, sizeof(int) * num_cities);
+	exchange(lk, best, &best_length);
+
+	/* kick the best tour and improve it again, keeping it if it is shorter */
+	for (int i = 1; i <= kicks && best_length != NO_TOUR; i++) {
+		if (kick(lk)) {
+			optimise(lk);
+			normalise(lk);
+			if (lk->length < best_length) {
+				best_length = lk->length;
+				memcpy(best, lk->order, sizeof(int) * num_cities);
+			} else {
+				set_order(lk, best, best_length);
+			}
+		}
+		if (i % EXCHANGE_INTERVAL == 0 || i == kicks) {
+			exchange(lk, best, &best_length);
+		}
+	}
+
+	/* a tour which still needs a missing edge does not count */
+	if (best_length == NO_TOUR || best_length >= lk->penalty) {
+		tour = tour_init(num_cities);
+		add_city(tour, 0, INT_MAX); /* indicates no tour was found */
+	} else {
+		tour = build_tour(graph, num_cities, best);
+	}
+
+	free(best);
+	lk_free(lk);
+
+	return tour;
+}
+
+/*--- local search -----------------------------------------------------------*/
+
+/** Improve the tour from every city in the queue until there are none left,
+ * putting the cities at the ends of every changed edge back in the queue */
+static void optimise(Lk *lk)
+{
+	int t1, t2, a, b;
+	long gain;
+
+	while (lk->queued > 0) {
+		t1 = lk->queue[lk->head];
+		lk->head = (lk->head + 1) % lk->n;
+		lk->queued--;
+		lk->in_queue[t1] = FALSE;
+
+		/* try breaking each of the edges at t1 in turn, by looking at the
+		 * tour one way round and then the other */
+		gain = 0;
+		for (int side = 0; side < 2 && gain == 0; side++) {
+			lk->reversed = !lk->reversed;
+			t2 = succ(lk, t1);
+			lk->num_moves = 0;
+			gain = improve_from(lk, t1, t2, weight(lk, t1, t2), 1);
+		}
+		if (gain == 0) {
+			continue;
+		}
+
+		lk->length -= gain;
+		push(lk, t1);
+		for (int i = 0; i < lk->num_moves; i++) {
+			a = lk->moves[2*i];
+			b = lk->moves[2*i + 1];
+			push(lk, a);
+			push(lk, b);
+			push(lk, succ(lk, a));
+			push(lk, pred(lk, a));
+			push(lk, succ(lk, b));
+			push(lk, pred(lk, b));
+		}
+	}
+}
+
+/** Extend a Lin-Kernighan move which has broken the edge from t1 to t2, with
+ * gain being the weight of the edges broken less those added so far. Each step
+ * adds an edge from t2 to one of its nearest neighbours t3 and breaks the edge
+ * from t3 to its predecessor t4, which is a 2-opt move reversing the path from
+ * t2 to t4, and leaves the edge from t1 to t4 to be broken next. Return the
+ * gain of the best tour found and leave the tour there, or return 0 with the
+ * tour as it was. */
+static long improve_from(Lk *lk, int t1, int t2, long gain, int depth)
+{
+	int t3, t4, tried = 0, width;
+	long g, here, deeper;
+
+	width = (depth <= 2) ? breadth[depth - 1] : 1;
+	for (int c = 0; c < CANDIDATES && tried < width; c++) {
+		t3 = lk->candidates[t2 * CANDIDATES + c];
+		if (t3 < 0 || gain - weight(lk, t2, t3) <= 0) {
+			break; /* the rest of the neighbours are further away */
+		}
+		if (t3 == t1 || t3 == succ(lk, t2)) {
+			continue;
+		}
+		t4 = pred(lk, t3);
+		g = gain - weight(lk, t2, t3) + weight(lk, t3, t4);
+		tried++;
+
+		flip(lk, t2, t4);
+		lk->moves[2 * lk->num_moves] = t2;
+		lk->moves[2 * lk->num_moves++ + 1] = t4;
+
+		/* prefer going deeper, otherwise stop here if closing the tour up
+		 * now is an improvement */
+		here = g - weight(lk, t4, t1);
+		deeper = (depth < MAX_DEPTH) ? improve_from(lk, t1, t4, g, depth + 1)
+			: 0;
+		if (deeper > 0) {
+			return deeper;
+		}
+		if (here > 0) {
+			return here;
+		}
+
+		flip(lk, t4, t2);
+		lk->num_moves--;
+	}
+
+	return 0;
+}
+
+/** Make a double-bridge move, which swaps two neighbouring segments of the
+ * tour so that it cannot be undone by one 2-opt move, and queue the cities at
+ * the ends of the new edges. Return false if no such move could be found which
+ * only uses edges of the graph. */
+static Boolean kick(Lk *lk)
+{
+	int n = lk->n, p1, p2, p3, *o = lk->order, e[6];
+	long removed, added;
+
+	if (n < 8) {
+		return FALSE;
+	}
+
+	for (int attempt = 0; attempt < KICK_ATTEMPTS; attempt++) {
+		/* cut the tour into A B C D, with B and C short */
+		p1 = 1 + random_below(lk, n - 3);
+		p2 = p1 + 1 + random_below(lk, (n - 2 - p1 < KICK_SEGMENT)
+				? n - 2 - p1 : KICK_SEGMENT);
+		p3 = p2 + 1 + random_below(lk, (n - 1 - p2 < KICK_SEGMENT)
+				? n - 1 - p2 : KICK_SEGMENT);
+
+		/* ends of A, B, C and D */
+		e[0] = o[p1 - 1];
+		e[1] = o[p1];
+		e[2] = o[p2 - 1];
+		e[3] = o[p2];
+		e[4] = o[p3 - 1];
+		e[5] = o[p3];
+		if (edge_weight(lk->graph, e[0], e[3]) == NO_EDGE
+				|| edge_weight(lk->graph, e[4], e[1]) == NO_EDGE
+				|| edge_weight(lk->graph, e[2], e[5]) == NO_EDGE) {
+			continue;
+		}
+		removed = weight(lk, e[0], e[1]) + weight(lk, e[2], e[3])
+			+ weight(lk, e[4], e[5]);
+		added = weight(lk, e[0], e[3]) + weight(lk, e[4], e[1])
+			+ weight(lk, e[2], e[5]);
+
+		/* rearrange into A C B D */
+		memcpy(lk->scratch, o + p2, sizeof(int) * (p3 - p2));
+		memcpy(lk->scratch + (p3 - p2), o + p1, sizeof(int) * (p2 - p1));
+		memcpy(o + p1, lk->scratch, sizeof(int) * (p3 - p1));
+		for (int i = p1; i < p3; i++) {
+			lk->pos[o[i]] = i;
+		}
+		lk->length += added - removed;
+
+		for (int i = 0; i < 6; i++) {
+			push(lk, e[i]);
+		}
+		return TRUE;
+	}
+
+	return FALSE;
+}
+
+/*--- tour representation ----------------------------------------------------*/
+
+/** Return the weight of the edge between two cities, or the penalty if there
+ * is none */
+static long weight(Lk *lk, int a, int b)
+{
+	int w = edge_weight(lk->graph, a, b);
+	return (w == NO_EDGE) ? lk->penalty : w;
+}
+
+/** Reverse the path from a to b, reversing the rest of the tour and the
+ * direction it runs in instead if that is shorter */
+static void flip(Lk *lk, int a, int b)
+{
+	int n = lk->n, i = lk->pos[a], j = lk->pos[b], len, x, y;
+
+	if (lk->reversed) {
+		x = i;
+		i = j;
+		j = x;
+	}
+	len = (j - i + n) % n + 1;
+	if (2 * len > n) {
+		x = (j + 1) % n;
+		j = (i + n - 1) % n;
+		i = x;
+		len = n - len;
+		lk->reversed = !lk->reversed;
+	}
+
+	for (int k = 0; k < len / 2; k++) {
+		x = lk->order[i];
+		y = lk->order[j];
+		lk->order[i] = y;
+		lk->pos[y] = i;
+		lk->order[j] = x;
+		lk->pos[x] = j;
+		i = (i + 1) % n;
+		j = (j + n - 1) % n;
+	}
+}
+
+/** Return the city after city in the tour */
+static int succ(Lk *lk, int city)
+{
+	return lk->order[(lk->pos[city] + (lk->reversed ? lk->n - 1 : 1)) % lk->n];
+}
+
+/** Return the city before city in the tour */
+static int pred(Lk *lk, int city)
+{
+	return lk->order[(lk->pos[city] + (lk->reversed ? 1 : lk->n - 1)) % lk->n];
+}
+
+/** Queue a city to be improved from, unless it already is */
+static void push(Lk *lk, int city)
+{
+	if (!lk->in_queue[city]) {
+		lk->queue[(lk->head + lk->queued++) % lk->n] = city;
+		lk->in_queue[city] = TRUE;
+	}
+}
+
+/** Lay the tour out forwards through order */
+static void normalise(Lk *lk)
+{
+	int x;
+
+	if (!lk->reversed) {
+		return;
+	}
+	for (int i = 0, j = lk->n - 1; i < j; i++, j--) {
+		x = lk->order[i];
+		lk->order[i] = lk->order[j];
+		lk->order[j] = x;
+	}
+	for (int i = 0; i < lk->n; i++) {
+		lk->pos[lk->order[i]] = i;
+	}
+	lk->reversed = FALSE;
+}
+
+/** Replace the tour with a copy of order */
+static void set_order(Lk *lk, int *order, long length)
+{
+	if (order != lk->order) {
+		memcpy(lk->order, order, sizeof(int) * lk->n);
+	}
+	for (int i = 0; i < lk->n; i++) {
+		lk->pos[order[i]] = i;
+	}
+	lk->reversed = FALSE;
+	lk->length = length;
+}
+
+/*--- messaging functions ----------------------------------------------------*/
+
+/** Replace every process's best tour with the shortest of them, and carry on
+ * from it */
+static void exchange(Lk *lk, int *best, long *best_length)
+{
+	struct {
+		long length;
+		int rank;
+	} mine, shortest;
+
+	mine.length = *best_length;
+	MPI_Comm_rank(MPI_COMM_WORLD, &mine.rank);
+	MPI_Allreduce(&mine, &shortest, 1, MPI_LONG_INT, MPI_MINLOC,
+			MPI_COMM_WORLD);
+	*best_length = shortest.length;
+	if (shortest.length == NO_TOUR) {
+		return;
+	}
+
+	MPI_Bcast(best, lk->n, MPI_INT, shortest.rank, MPI_COMM_WORLD);
+	set_order(lk, best, *best_length);
+}
+
+/*--- utility functions ------------------------------------------------------*/
+
+/** Return the tour which visits the cities of a graph of at most three cities
+ * in order, or one with a cost of INT_MAX if an edge it needs is missing or
+ * there are too few cities for a tour */
+static Partial_tour *only_tour(Graph *graph, int num_cities)
+{
+	int order[3] = {0, 1, 2};
+	Boolean complete = num_cities >= 2;
+	Partial_tour *tour;
+
+	for (int i = 0; complete && i < num_cities; i++) {
+		complete = edge_weight(graph, i, (i + 1) % num_cities) != NO_EDGE;
+	}
+	if (!complete) {
+		tour = tour_init(num_cities);
+		add_city(tour, 0, INT_MAX); /* indicates no tour was found */
+		return tour;
+	}
+	return build_tour(graph, num_cities, order);
+}
+
+/** Allocate the state of the local search, seeding its random numbers */
+static Lk *lk_init(Graph *graph, int num_cities, int seed)
+{
+	int n = (num_cities > 0) ? num_cities : 1;
+	Lk *lk = (Lk *) malloc(sizeof(Lk));
+
+	lk->graph = graph;
+	lk->n = num_cities;
+	lk->candidates = (int *) malloc(sizeof(int) * CANDIDATES * n);
+	lk->order = (int *) malloc(sizeof(int) * n);
+	lk->pos = (int *) malloc(sizeof(int) * n);
+	lk->reversed = FALSE;
+	lk->length = NO_TOUR;
+	lk->queue = (int *) malloc(sizeof(int) * n);
+	lk->head = 0;
+	lk->queued = 0;
+	lk->in_queue = (Boolean *) calloc(n, sizeof(Boolean));
+	lk->moves = (int *) malloc(sizeof(int) * 2 * MAX_DEPTH);
+	lk->num_moves = 0;
+	lk->scratch = (int *) malloc(sizeof(int) * n);
+	lk->random = 0x9E3779B97F4A7C15ULL * (seed + 1);
+
+	find_candidates(lk);
+
+	return lk;
+}
+
+/** Free the state of the local search */
+static void lk_free(Lk *lk)
+{
+	free(lk->candidates);
+	free(lk->order);
+	free(lk->pos);
+	free(lk->queue);
+	free(lk->in_queue);
+	free(lk->moves);
+	free(lk->scratch);
+	free(lk);
+}
+
+/** Copy the nearest neighbours of every city out of the graph's candidate
+ * lists, and find the penalty for missing edges */
+static void find_candidates(Lk *lk)
+{
+	int count, degree, heaviest = 0, *list;
+	const int *neighbours, *costs;
+
+	for (int i = 0; i < lk->n; i++) {
+		list = lk->candidates + i * CANDIDATES;
+		count = candidates(lk->graph, i, CANDIDATES, &neighbours);
+		for (int k = 0; k < CANDIDATES; k++) {
+			list[k] = (k < count) ? neighbours[k] : -1;
+		}
+		degree = neighbours_by_cost(lk->graph, i, NULL, &costs);
+		if (degree > 0 && costs[degree-1] > heaviest) {
+			heaviest = costs[degree-1];
+		}
+	}
+	lk->penalty = (long) heaviest * lk->n + 1;
+}
+
+/** Build a nearest neighbour tour from a random city. If every neighbour has
+ * been visited, jump to the next city which has not been, along a missing
+ * edge. Queue every city to be improved from. */
+static void first_tour(Lk *lk)
+{
+	int n = lk->n, city, next, degree, unvisited = 0;
+	long length = 0;
+	const int *neighbours;
+	Boolean *seen = (Boolean *) calloc(n, sizeof(Boolean));
+
+	lk->order[0] = random_below(lk, n);
+	seen[lk->order[0]] = TRUE;
+	for (int i = 1; i < n; i++) {
+		city = lk->order[i-1];
+		next = -1;
+		degree = neighbours_by_cost(lk->graph, city, &neighbours, NULL);
+		for (int j = 0; j < degree && next < 0; j++) {
+			if (!seen[neighbours[j]]) {
+				next = neighbours[j];
+			}
+		}
+		if (next < 0) {
+			while (seen[unvisited]) {
+				unvisited++;
+			}
+			next = unvisited;
+		}
+		lk->order[i] = next;
+		seen[next] = TRUE;
+		length += weight(lk, city, next);
+	}
+	length += weight(lk, lk->order[n-1], lk->order[0]);
+	free(seen);
+
+	set_order(lk, lk->order, length);
+	for (int i = 0; i < n; i++) {
+		push(lk, lk->order[i]);
+	}
+}
+
+/** Return a random number from 0 to bound - 1, from a xorshift generator */
+static int random_below(Lk *lk, int bound)
+{
+	lk->random ^= lk->random << 13;
+	lk->random ^= lk->random >> 7;
+	lk->random ^= lk->random << 17;
+	return (int) (lk->random % (uint64_t) bound);
+}
@@ -0,0 +1,41 @@
+/**
+ * @file    lk.h
+ * @brief   Iterated Lin-Kernighan heuristic for graphs too large to solve
+ *          exactly.
+ * @author  L. Foxcroft
+ * @date    2022-06-18
+ */
+
+#ifndef LK_H
+#define LK_H
+
+#include "graph.h"
+#include "stack.h"
+
+/** the number of kicks each process makes if it is not told otherwise */
+#define LK_DEFAULT_KICKS 1000
+
+/*--- function prototypes ----------------------------------------------------*/
+
+/**
+ * Finds a good tour of a graph of any size. Each process builds a nearest
+ * neighbour tour from a different random city and improves it with
+ * Lin-Kernighan moves (chains of 2-opt moves guided by lists of each city's
+ * nearest neighbours, with don't-look bits so that only cities near a change
+ * are looked at again). It then repeatedly kicks the tour with a random
+ * double-bridge move and improves it again, keeping the result if it is
+ * shorter. Every so often the processes swap in the best tour any of them has
+ * found. Every process in MPI_COMM_WORLD should call this at the same time.
+ *
+ * @param[in]   graph
+ *     a pointer to the graph to find a tour of
+ * @param[in]   num_cities
+ *     the number of cities in the graph
+ * @param[in]   kicks
+ *     the number of kicks each process makes
+ * @return      the best tour found by any process, which is the same on every
+ *              process and has a cost of INT_MAX if none was found
+ */
+Partial_tour *lin_kernighan(Graph *graph, int num_cities, int kicks);
+
+#endif /* LK_H */
@@ -0,0 +1,160 @@
+/**
+ * @file    microbench.c
+ * @brief   Times the stack and graph operations at the heart of the search, and
+ *          prints one CSV row per operation.
+ * @author  L. Foxcroft
+ * @date    2022-06-22
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+#include "graph.h"
+#include "stack.h"
+
+/* the number of cities in the tours and graphs timed */
+#define CITIES 64
+/* the number of tours pushed onto the stack between pops */
+#define DEPTH 1024
+
+/*--- function prototypes ----------------------------------------------------*/
+
+static double time_stack(Stack *stack, Partial_tour *tour, long rounds,
+		Boolean front);
+static double time_adj(Graph *graph, long rounds, long *found);
+static Graph *complete_graph(int n, Backend backend);
+static double now(void);
+static void report(const char *operation, long iterations, double seconds);
+
+/*--- main routine -----------------------------------------------------------*/
+
+int main(int argc, char *argv[])
+{
+	long rounds = (argc > 1) ? atol(argv[1]) : 2000, found;
+	double seconds;
+	Stack *stack = stack_init(CITIES);
+	Partial_tour *tour = tour_init(CITIES);
+	Graph *graph;
+
+	if (rounds < 1) {
+		fprintf(stderr, "usage: %s [rounds]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+	for (int city = 1; city < CITIES / 2; city++) {
+		add_city(tour, city, city);
+	}
+
+	printf("operation,iterations,seconds,ns_per_op\n");
+
+	/* each round pushes DEPTH tours and pops them all again */
+	seconds = time_stack(stack, tour, rounds, FALSE);
+	report("push_copy+pop", rounds * DEPTH, seconds);
+	seconds = time_stack(stack, tour, rounds, TRUE);
+	report("push_copy+pop_front", rounds * DEPTH, seconds);
+
+	/* each round walks the neighbours of every city */
+	graph = complete_graph(CITIES, GRAPH_DENSE);
+	seconds = time_adj(graph, rounds, &found);
+	report("adj_dense", found, seconds);
+	free_graph(graph);
+	graph = complete_graph(CITIES, GRAPH_SPARSE);
+	seconds = time_adj(graph, rounds, &found);
+	report("adj_sparse", found, seconds);
+	free_graph(graph);
+
+	free_tour(tour);
+	free_stack(stack);
+
+	return EXIT_SUCCESS;
+}
+
+/*--- timings ----------------------------------------------------------------*/
+
+/** Time pushing copies of tour onto the stack and popping them off again from
+ * the top, or from the bottom if front is set */
+static double time_stack(Stack *stack, Partial_tour *tour, long rounds,
+		Boolean front)
+{
+	double start = now();
+
+	for (long r = 0; r < rounds; r++) {
+		for (int i = 0; i < DEPTH; i++) {
+			push_copy(stack, tour);
+		}
+		for (int i = 0; i < DEPTH; i++) {
+			if (front) {
+				pop_front(stack, tour);
+			} else {
+				pop(stack, tour);
+			}
+		}
+	}
+	return now() - start;
+}
+
+/** Time walking the neighbours of every city, counting the edges seen in found
+ * so the walk cannot be optimised away */
+static double time_adj(Graph *graph, long rounds, long *found)
+{
+	int neighbour, cost;
+	long sum = 0;
+	double start = now();
+	Adj_iter iter;
+
+	*found = 0;
+	for (long r = 0; r < rounds; r++) {
+		for (int city = 0; city < CITIES; city++) {
+			if (adj(graph, &iter, &city, &neighbour, &cost)) {
+				do {
+					sum += cost;
+					(*found)++;
+				} while (adj(graph, &iter, NULL, &neighbour, &cost));
+			}
+		}
+	}
+	start = now() - start;
+	if (sum < 0) {
+		printf("%ld\n", sum);
+	}
+	return start;
+}
+
+/*--- utility functions ------------------------------------------------------*/
+
+/** Build a complete graph on n cities with the given backend */
+static Graph *complete_graph(int n, Backend backend)
+{
+	int e = n * (n - 1) / 2, k = 0;
+	int **edges = (int **) malloc(sizeof(int *) * e);
+	int *block = (int *) malloc(sizeof(int) * 3 * e);
+	Graph *graph;
+
+	for (int i = 0; i < n; i++) {
+		for (int j = i + 1; j < n; j++, k++) {
+			edges[k] = block + 3 * k;
+			edges[k][0] = i;
+			edges[k][1] = j;
+			edges[k][2] = 1 + (i * 31 + j * 17) % 100;
+		}
+	}
+	graph = build_graph_backend(n, e, edges, backend);
+	free(block);
+	free(edges);
+	return graph;
+}
+
+/** Return the time in seconds from a monotonic clock */
+static double now(void)
+{
+	struct timespec t;
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+/** Print one CSV row of results */
+static void report(const char *operation, long iterations, double seconds)
+{
+	printf("%s,%ld,%.6f,%.2f\n", operation, iterations, seconds,
+			(iterations > 0) ? seconds * 1e9 / iterations : 0.0);
+}
@@ -0,0 +1,680 @@
+/**
+ * @file    search.c
+ * @brief   Depth first branch and bound search with a pool of worker threads
+ *          per process.
+ * @author  L. Foxcroft
+ * @date    2022-06-12
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <limits.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sched.h>
+#include <mpi.h>
+#include "search.h"
+#include "balance.h"
+#include "deque.h"
+#include "checkpoint.h"
+
+/* how many tours a worker expands between looking at the outside world */
+#define POLL_INTERVAL 1024
+/* the most tours a worker offers to the others at once */
+#define DEQUE_CAPACITY 64
+
+/** a container for the state shared by every worker in a process */
+typedef struct search {
+	/** the graph being searched */
+	Graph *graph;
+	/** the number of cities in the graph */
+	int num_cities;
+	/** the number of worker threads */
+	int num_threads;
+	/** which lower bound to use at each depth */
+	Schedule *schedule;
+	/** the scratch space the caller keeps for each worker's bounds, or NULL
+	 * if the workers allocate their own */
+	Bounds **bounds;
+	/** the workers searching the graph */
+	struct worker *workers;
+	/** the cost of the best tour known to this process */
+	atomic_int best_cost;
+	/** the number of workers which have run out of work */
+	atomic_int idle;
+	/** set once every process has run out of work */
+	atomic_int done;
+	/** window exposing the best cost known to any process */
+	MPI_Win incumbent;
+	/** balances work between processes */
+	Balancer *balancer;
+	/** writes checkpoints, or NULL if there are none */
+	Checkpointer *checkpointer;
+	/** the best tour known before the search started */
+	Partial_tour *start_tour;
+	/** set once a worker finds a better tour, until it has been checkpointed */
+	atomic_int improved;
+	/** whether worker 0 has received work from another process since the last
+	 * checkpoint */
+	Boolean received;
+	/** set while worker 0 takes a checkpoint, to pause the other workers */
+	atomic_int pausing;
+	/** the number of other workers which have paused */
+	atomic_int paused;
+	/** every tour left to search, gathered for a checkpoint */
+	Stack *snapshot;
+	/** serialises the workers adding to the snapshot */
+	pthread_mutex_t snapshot_lock;
+	/** the number of seconds between progress reports, or 0 for none */
+	double progress;
+	/** the time at which the next progress report is due */
+	double next_progress;
+	/** the counters of the whole process, which the workers' are merged
+	 * into */
+	Stats *stats;
+} Search;
+
+/** a container for the state of a single worker */
+typedef struct worker {
+	/** index of the worker, where worker 0 is the calling thread */
+	int id;
+	/** the shared search state */
+	Search *search;
+	/** the worker's private depth first search stack */
+	Stack *stack;
+	/** the worker's private best first queue, or NULL when searching depth
+	 * first */
+	Heap *heap;
+	/** tours the worker has put aside for others to steal */
+	Deque *deque;
+	/** the best tour the worker found */
+	Partial_tour *best_tour;
+	/** scratch space for the worker's lower bounds */
+	Bounds *bounds;
+	/** the number of partial tours the worker has expanded, which worker 0
+	 * reads for progress reports */
+	atomic_long expanded;
+	/** the worker's own counters */
+	Stats *stats;
+	/** the thread running the worker */
+	pthread_t thread;
+} Worker;
+
+/*--- function prototypes ----------------------------------------------------*/
+
+static void *work(void *arg);
+static Boolean find_work(Worker *worker);
+static Boolean take(Worker *worker, Partial_tour *tour);
+static void share(Worker *worker);
+static void spill(Worker *worker);
+static void poll_checkpoint(Search *search, Partial_tour *current,
+		Boolean idle);
+static void take_checkpoint(Search *search, Partial_tour *current,
+		Boolean last, Boolean rotate);
+static void pause_point(Worker *worker);
+static void snapshot_worker(Worker *worker);
+static Boolean queued(Worker *worker);
+static void report_progress(Search *search);
+static void lower_best_cost(Search *search, int cost);
+static void sync_incumbent(Search *search);
+static void incumbent_init(MPI_Win *incumbent);
+static int incumbent_update(MPI_Win incumbent, int cost);
+static void incumbent_free(MPI_Win *incumbent);
+
+/*--- search interface -------------------------------------------------------*/
+
+void find_best_tour(Graph *graph, Stack *subproblems, int num_cities,
+		int num_threads, Schedule *schedule, Bounds **bounds,
+		long queue_bytes, Checkpointer *checkpointer, double progress,
+		Stats *stats, Partial_tour *best_tour)
+{
+	int cnt;
+	Search search;
+	Worker *best;
+	Partial_tour *tour;
+
+	search.graph = graph;
+	search.num_cities = num_cities;
+	search.num_threads = num_threads;
+	search.schedule = schedule;
+	search.bounds = bounds;
+	search.workers = (Worker *) malloc(sizeof(Worker) * num_threads);
+	atomic_init(&search.best_cost, tour_cost(best_tour));
+	atomic_init(&search.idle, 0);
+	atomic_init(&search.done, 0);
+	incumbent_init(&search.incumbent);
+	search.balancer = balance_init(num_cities, checkpointer != NULL);
+	search.checkpointer = checkpointer;
+	search.start_tour = best_tour;
+	atomic_init(&search.improved, 0);
+	search.received = FALSE;
+	atomic_init(&search.pausing, 0);
+	atomic_init(&search.paused, 0);
+	search.snapshot = stack_init(num_cities);
+	pthread_mutex_init(&search.snapshot_lock, NULL);
+	search.progress = progress;
+	search.next_progress = stats_clock() + progress;
+	search.stats = stats;
+
+	for (int i = 0; i < num_threads; i++) {
+		search.workers[i].id = i;
+		search.workers[i].search = &search;
+		search.workers[i].stack = stack_init(num_cities);
+		search.workers[i].deque = deque_init(DEQUE_CAPACITY);
+		search.workers[i].heap = (queue_bytes > 0)
+			? heap_init(num_cities, queue_bytes / num_threads) : NULL;
+		atomic_init(&search.workers[i].expanded, 0);
+		search.workers[i].stats = stats_init(num_cities, stats->start);
+	}
+
+	/* deal the subproblems out to the workers in a cyclic fashion */
+	tour = tour_init(num_cities);
+	for (cnt = 0; stack_size(subproblems) > 0; cnt++) {
+		pop(subproblems, tour);
+		push_copy(search.workers[cnt % num_threads].stack, tour);
+	}
+	free_tour(tour);
+
+	/* this thread is worker 0, and it is the only one to talk to MPI */
+	for (int i = 1; i < num_threads; i++) {
+		pthread_create(&search.workers[i].thread, NULL, work,
+				&search.workers[i]);
+	}
+	work(&search.workers[0]);
+	for (int i = 1; i < num_threads; i++) {
+		pthread_join(search.workers[i].thread, NULL);
+	}
+
+	/* record that there is nothing left to search, along with the best
+	 * tour */
+	if (checkpointer != NULL) {
+		take_checkpoint(&search, NULL, TRUE, FALSE);
+	}
+
+	/* keep the best tour any worker found, if it beats the one we started
+	 * with */
+	best = &search.workers[0];
+	for (int i = 1; i < num_threads; i++) {
+		if (tour_cost(search.workers[i].best_tour) < tour_cost(best->best_tour)) {
+			best = &search.workers[i];
+		}
+	}
+	if (tour_cost(best->best_tour) < tour_cost(best_tour)) {
+		copy_tour(best_tour, best->best_tour);
+	}
+	for (int i = 0; i < num_threads; i++) {
+		search.workers[i].stats->expanded
+			= atomic_load(&search.workers[i].expanded);
+		STAT_high_water(search.workers[i].stats,
+				stack_high_water(search.workers[i].stack));
+		stats_merge(stats, search.workers[i].stats);
+		stats_free(search.workers[i].stats);
+		free_tour(search.workers[i].best_tour);
+		free_stack(search.workers[i].stack);
+		free_deque(search.workers[i].deque);
+		if (search.workers[i].heap != NULL) {
+			free_heap(search.workers[i].heap);
+		}
+	}
+
+	balance_free(search.balancer);
+	free_stack(search.snapshot);
+	pthread_mutex_destroy(&search.snapshot_lock);
+	incumbent_free(&search.incumbent);
+	free(search.workers);
+}
+
+Boolean mirrored(Graph *graph, Partial_tour *tour, int city)
+{
+	return city == 2 && !visited(tour, 1) && !graph_directed(graph);
+}
+
+/*--- worker threads ---------------------------------------------------------*/
+
+/** Run a depth first search from the worker's stack until every process has
+ * run out of work. If the worker has a queue, children are pushed onto it
+ * instead while it has room, and the best tour on it is expanded whenever the
+ * stack is empty, so the search is best first until the queue fills up and then
+ * depth first below the tours it pops. Partial tours are pruned as soon as
+ * their lower bound reaches the cost of the best tour found by any thread of
+ * any process. */
+static void *work(void *arg)
+{
+	Worker *worker = (Worker *) arg;
+	Search *search = worker->search;
+	Graph *graph = search->graph;
+	int num_cities = search->num_cities;
+	int city, neighbour, cost, degree, expanded, limit, bound, key = 0;
+	const int *neighbours, *costs;
+	Boolean from_queue;
+	Partial_tour *helper_tour, *tour_ptr;
+	STAT_start(begin);
+
+	/* initialize tours, helper gets written to during search */
+	worker->best_tour = tour_init(num_cities);
+	add_city(worker->best_tour, 0, INT_MAX); /* indicates no tour is possible */
+	helper_tour = tour_init(num_cities);
+	worker->bounds = (search->bounds != NULL) ? search->bounds[worker->id]
+		: bounds_init(graph, num_cities, search->schedule);
+	expanded = 0;
+
+	/* iterative search */
+	while (stack_size(worker->stack) > 0 || queued(worker)
+			|| find_work(worker)) {
+		from_queue = stack_size(worker->stack) == 0;
+		if (from_queue) {
+			key = heap_pop(worker->heap, helper_tour);
+		} else {
+			pop(worker->stack, helper_tour);
+		}
+
+		/* every so often pick up better tours found by other processes,
+		 * share our work with any processes which have run out, and save
+		 * every tour left to search, including the one just taken */
+		if (worker->id == 0 && ++expanded % POLL_INTERVAL == 0) {
+			sync_incumbent(search);
+			spill(worker);
+			balance_poll(search->balancer, worker->stack);
+			if (search->progress > 0
+					&& stats_clock() >= search->next_progress) {
+				report_progress(search);
+			}
+			poll_checkpoint(search, helper_tour, FALSE);
+		}
+
+		/* the incumbent may have improved since this tour was pushed. A tour
+		 * from the queue was pushed with its lower bound as its key, and every
+		 * tour left on the queue has a key at least as large. A tour from the
+		 * stack keeps the bound it was pushed with, unless it came from
+		 * another process. */
+		limit = atomic_load_explicit(&search->best_cost, memory_order_relaxed);
+		if (from_queue && key >= limit) {
+			STAT_add(worker->stats, dropped, heap_size(worker->heap) + 1);
+			heap_clear(worker->heap);
+			continue;
+		} else if (!from_queue) {
+			bound = tour_bound(helper_tour);
+			if (bound == NO_BOUND) {
+				bound = lower_bound(worker->bounds, helper_tour, limit);
+			}
+			if (bound >= limit) {
+				STAT_pruned(worker->stats, tour_count(helper_tour));
+				continue;
+			}
+		}
+
+		city = last_city(helper_tour);
+
+		/* once every city has been visited the tour can only return to 0 */
+		if (tour_count(helper_tour) == num_cities) {
+			cost = edge_weight(graph, city, 0);
+			if (cost != NO_EDGE && tour_cost(helper_tour) + cost
+					< atomic_load(&search->best_cost)) {
+				/* swap pointers and tell the other workers */
+				add_city(helper_tour, 0, cost);
+				tour_ptr = worker->best_tour;
+				worker->best_tour = helper_tour;
+				helper_tour = tour_ptr;
+				lower_best_cost(search, tour_cost(worker->best_tour));
+				atomic_store(&search->improved, 1);
+				STAT_improved(worker->stats, tour_cost(worker->best_tour));
+			}
+			continue;
+		}
+
+		/* else continue search by visiting neighbouring cities, unless the
+		 * extended tour can't beat the incumbent. The cheapest edge is pushed
+		 * last so that it is explored first, which finds good tours early. */
+		/* only this worker writes the count, so it needs no locked add */
+		atomic_store_explicit(&worker->expanded, atomic_load_explicit(
+					&worker->expanded, memory_order_relaxed) + 1,
+				memory_order_relaxed);
+		degree = neighbours_by_cost(graph, city, &neighbours, &costs);
+		for (int i = degree - 1; i >= 0; i--) {
+			neighbour = neighbours[i];
+			cost = costs[i];
+			if (!visited(helper_tour, neighbour)
+					&& !mirrored(graph, helper_tour, neighbour)) {
+				add_city(helper_tour, neighbour, cost);
+				limit = atomic_load_explicit(&search->best_cost,
+						memory_order_relaxed);
+				bound = lower_bound(worker->bounds, helper_tour, limit);
+				set_tour_bound(helper_tour, bound);
+				if (bound < limit && worker->heap != NULL
+						&& !heap_full(worker->heap)) {
+					heap_push(worker->heap, helper_tour, bound);
+				} else if (bound < limit) {
+					push_copy(worker->stack, helper_tour);
+				} else {
+					STAT_pruned(worker->stats, tour_count(helper_tour));
+				}
+				remove_city(helper_tour, cost);
+			}
+		}
+
+		share(worker);
+
+		/* wait while worker 0 saves every tour left to search */
+		if (worker->id != 0) {
+			pause_point(worker);
+		}
+	}
+
+	free_tour(helper_tour);
+	if (search->bounds == NULL) {
+		bounds_free(worker->bounds);
+	}
+	STAT_since(worker->stats, elapsed, begin);
+
+	return NULL;
+}
+
+/** Refill an empty stack, first from our own deque, then by stealing from the
+ * other workers, and finally (for worker 0, once every worker is idle) from the
+ * other processes. Returns false once every process has run out of work. */
+static Boolean find_work(Worker *worker)
+{
+	Search *search = worker->search;
+	Worker *victim;
+	Partial_tour *tour;
+	Boolean empty;
+
+	if ((tour = deque_pop(worker->deque)) != NULL) {
+		return take(worker, tour);
+	}
+
+	/* the worker is idle from here until it finds work */
+	STAT_start(since);
+	atomic_fetch_add(&search->idle, 1);
+	while (!atomic_load(&search->done)) {
+		for (int i = 1; i < search->num_threads; i++) {
+			victim = &search->workers[(worker->id + i) % search->num_threads];
+			if (deque_size(victim->deque) > 0) {
+				/* count ourselves busy before the tour leaves the deque, so
+				 * worker 0 never sees the tour in neither place */
+				atomic_fetch_sub(&search->idle, 1);
+				if ((tour = deque_steal(victim->deque)) != NULL) {
+					STAT_since(worker->stats, idle, since);
+					return take(worker, tour);
+				}
+				atomic_fetch_add(&search->idle, 1);
+			}
+		}
+
+		if (worker->id != 0) {
+			pause_point(worker);
+			sched_yield();
+			continue;
+		}
+
+		/* worker 0 still answers the other processes and takes checkpoints
+		 * while it waits */
+		sync_incumbent(search);
+		balance_poll(search->balancer, worker->stack);
+		poll_checkpoint(search, NULL, FALSE);
+
+		/* the process is idle if every worker is, with nothing left to steal,
+		 * and no worker became busy while we were checking */
+		if (atomic_load(&search->idle) != search->num_threads) {
+			continue;
+		}
+		empty = TRUE;
+		for (int i = 1; i < search->num_threads; i++) {
+			empty = empty && deque_size(search->workers[i].deque) == 0;
+		}
+		if (!empty || atomic_load(&search->idle) != search->num_threads) {
+			continue;
+		}
+
+		/* the process may wait a long time for more work, so save what came
+		 * of any it was sent before it does */
+		poll_checkpoint(search, NULL, TRUE);
+		if (balance_get_work(search->balancer, worker->stack)) {
+			search->received = TRUE;
+			atomic_fetch_sub(&search->idle, 1);
+			STAT_since(worker->stats, idle, since);
+			return TRUE;
+		}
+		atomic_store(&search->done, 1);
+	}
+
+	STAT_since(worker->stats, idle, since);
+	return FALSE;
+}
+
+/** Move a tour taken from a deque onto the worker's stack. */
+static Boolean take(Worker *worker, Partial_tour *tour)
+{
+	push_copy(worker->stack, tour);
+	free_tour(tour);
+	return TRUE;
+}
+
+/** If another worker is idle and we have nothing put aside for it, put the
+ * oldest tour on our stack, which is likely to have the largest subtree, on our
+ * deque to be stolen, or failing that the best tour on our queue. */
+static void share(Worker *worker)
+{
+	Search *search = worker->search;
+	Partial_tour *tour;
+
+	if (search->num_threads == 1
+			|| atomic_load_explicit(&search->idle, memory_order_relaxed) == 0
+			|| deque_size(worker->deque) > 0) {
+		return;
+	}
+	if (stack_size(worker->stack) > 1) {
+		tour = tour_init(search->num_cities);
+		pop_front(worker->stack, tour);
+		deque_push(worker->deque, tour);
+	} else if (queued(worker) && heap_size(worker->heap) > 1) {
+		tour = tour_init(search->num_cities);
+		heap_pop(worker->heap, tour);
+		deque_push(worker->deque, tour);
+	}
+}
+
+/** If another process is waiting for work and our stack is too small to split,
+ * move the better half of our queue onto the stack so that the load balancer
+ * can send some of it. Only worker 0 may call this. */
+static void spill(Worker *worker)
+{
+	Partial_tour *tour;
+
+	if (!queued(worker) || stack_size(worker->stack) > 1
+			|| !balance_requested(worker->search->balancer)) {
+		return;
+	}
+	tour = tour_init(worker->search->num_cities);
+	for (int i = (heap_size(worker->heap) + 1) / 2; i > 0; i--) {
+		heap_pop(worker->heap, tour);
+		push_copy(worker->stack, tour);
+	}
+	free_tour(tour);
+}
+
+/** Take a checkpoint if one is due, or early if a worker has found a better
+ * tour since the last one was taken and it has been written, or if the process
+ * is about to go idle having received work from another process since the last
+ * one. The sender only keeps copies of the work it sends for a checkpoint
+ * interval or two, so the result of searching it has to be saved before then.
+ * Checkpoints taken early leave the copies of sent work alone, so that they are
+ * still kept for as long. Only worker 0 may call this, and current is the tour
+ * it is in the middle of expanding, if any. */
+static void poll_checkpoint(Search *search, Partial_tour *current,
+		Boolean idle)
+{
+	if (search->checkpointer == NULL) {
+		return;
+	}
+	if (checkpoint_due(search->checkpointer)) {
+		take_checkpoint(search, current, FALSE, TRUE);
+	} else if ((idle && search->received) || (atomic_load(&search->improved)
+				&& checkpoint_ready(search->checkpointer))) {
+		take_checkpoint(search, current, FALSE, FALSE);
+	}
+}
+
+/** Pause the other workers, gather every tour left to search and the best tour
+ * any worker has found, and hand them to the checkpointer to be written in the
+ * background, starting a new interval of work sent to other processes if
+ * rotate is set. Worker 0 has taken current, if it is not NULL, off its stack
+ * without expanding it yet, so it is saved too. The last checkpoint of a search
+ * is written before returning, and is taken once every worker has stopped.
+ * Only worker 0 may call this. */
+static void take_checkpoint(Search *search, Partial_tour *current,
+		Boolean last, Boolean rotate)
+{
+	Partial_tour *best = search->start_tour;
+
+	if (!last) {
+		atomic_store(&search->pausing, 1);
+		snapshot_worker(&search->workers[0]);
+		if (current != NULL) {
+			pthread_mutex_lock(&search->snapshot_lock);
+			push_copy(search->snapshot, current);
+			pthread_mutex_unlock(&search->snapshot_lock);
+		}
+		while (atomic_load(&search->paused) < search->num_threads - 1) {
+			sched_yield();
+		}
+	}
+
+	/* the other workers only swap their best tours while running, so every
+	 * improvement so far is saved */
+	atomic_store(&search->improved, 0);
+	search->received = FALSE;
+	for (int i = 0; i < search->num_threads; i++) {
+		if (tour_cost(search->workers[i].best_tour) < tour_cost(best)) {
+			best = search->workers[i].best_tour;
+		}
+	}
+	if (!last) {
+		balance_checkpoint(search->balancer, search->snapshot, rotate);
+	}
+	checkpoint_write(search->checkpointer, search->snapshot, best, last);
+
+	atomic_store(&search->paused, 0);
+	atomic_store(&search->pausing, 0);
+}
+
+/** If worker 0 is taking a checkpoint, add the worker's tours to the snapshot
+ * and wait for it to finish. Workers only call this when they are not in the
+ * middle of expanding a tour. */
+static void pause_point(Worker *worker)
+{
+	Search *search = worker->search;
+
+	if (!atomic_load_explicit(&search->pausing, memory_order_acquire)) {
+		return;
+	}
+	snapshot_worker(worker);
+	atomic_fetch_add(&search->paused, 1);
+	while (atomic_load(&search->pausing)) {
+		sched_yield();
+	}
+}
+
+/** Add copies of every tour on the worker's stack and queue to the snapshot,
+ * first taking back any tours it put aside for others to steal */
+static void snapshot_worker(Worker *worker)
+{
+	Search *search = worker->search;
+	Partial_tour *tour;
+
+	while ((tour = deque_pop(worker->deque)) != NULL) {
+		push_copy(worker->stack, tour);
+		free_tour(tour);
+	}
+
+	pthread_mutex_lock(&search->snapshot_lock);
+	copy_stack(search->snapshot, worker->stack);
+	if (worker->heap != NULL) {
+		copy_heap(search->snapshot, worker->heap);
+	}
+	pthread_mutex_unlock(&search->snapshot_lock);
+}
+
+/** Return whether the worker has tours waiting on its queue */
+static Boolean queued(Worker *worker)
+{
+	return worker->heap != NULL && heap_size(worker->heap) > 0;
+}
+
+/** Print how far this process has got to standard error: the partial tours its
+ * workers have expanded, the best cost it knows of, the tours on worker 0's
+ * stack and how many workers are idle. Only worker 0 may call this. */
+static void report_progress(Search *search)
+{
+	int my_rank;
+	long expanded = 0;
+	double now = stats_clock();
+
+	for (int i = 0; i < search->num_threads; i++) {
+		expanded += atomic_load_explicit(&search->workers[i].expanded,
+				memory_order_relaxed);
+	}
+	MPI_Comm_rank(MPI_COMM_WORLD, &my_rank);
+	fprintf(stderr, "progress rank %d seconds %.1f expanded %ld best %d"
+			" stack %d idle %d\n", my_rank, now - search->stats->start,
+			expanded, atomic_load(&search->best_cost),
+			stack_size(search->workers[0].stack), atomic_load(&search->idle));
+	search->next_progress = now + search->progress;
+}
+
+/** Lower the cost of the best tour known to this process to cost, if it is an
+ * improvement. */
+static void lower_best_cost(Search *search, int cost)
+{
+	int best_cost = atomic_load(&search->best_cost);
+	while (cost < best_cost && !atomic_compare_exchange_weak(&search->best_cost,
+				&best_cost, cost));
+}
+
+/** Swap the best cost known to this process for the best cost known to any
+ * process. Only worker 0 may call this. */
+static void sync_incumbent(Search *search)
+{
+	lower_best_cost(search, incumbent_update(search->incumbent,
+				atomic_load(&search->best_cost)));
+}
+
+/*--- messaging functions ----------------------------------------------------*/
+
+/** Create a window exposing the cost of the best tour found so far, which lives
+ * on process 0. Every process holds a shared lock on it for the whole search
+ * so that the incumbent can be read and lowered with one sided atomics. */
+static void incumbent_init(MPI_Win *incumbent)
+{
+	int my_rank, *best_cost;
+	MPI_Aint size;
+
+	MPI_Comm_rank(MPI_COMM_WORLD, &my_rank);
+	size = (my_rank == 0) ? sizeof(int) : 0;
+	MPI_Win_allocate(size, sizeof(int), MPI_INFO_NULL, MPI_COMM_WORLD,
+			&best_cost, incumbent);
+	if (my_rank == 0) {
+		*best_cost = INT_MAX;
+	}
+	MPI_Barrier(MPI_COMM_WORLD);
+	MPI_Win_lock_all(MPI_MODE_NOCHECK, *incumbent);
+}
+
+/** Lower the shared incumbent to cost if it is an improvement, and return the
+ * new cost of the best tour found by any process. */
+static int incumbent_update(MPI_Win incumbent, int cost)
+{
+	int best_cost;
+
+	MPI_Fetch_and_op(&cost, &best_cost, MPI_INT, 0, 0, MPI_MIN, incumbent);
+	MPI_Win_flush(0, incumbent);
+
+	return (cost < best_cost) ? cost : best_cost;
+}
+
+/** Release the shared lock on the incumbent and free the window. */
+static void incumbent_free(MPI_Win *incumbent)
+{
+	MPI_Win_unlock_all(*incumbent);
+	MPI_Win_free(incumbent);
+}
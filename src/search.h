@@ -0,0 +1,86 @@
+/**
+ * @file    search.h
+ * @brief   Branch and bound search for the best tour, shared between the
+ *          threads of a process and between MPI processes.
+ * @author  L. Foxcroft
+ * @date    2022-06-12
+ */
+
+#ifndef SEARCH_H
+#define SEARCH_H
+
+#include "graph.h"
+#include "stack.h"
+#include "bound.h"
+#include "checkpoint.h"
+#include "stats.h"
+
+/*--- function prototypes ----------------------------------------------------*/
+
+/**
+ * Searches for the best tour that extends any of the specified subproblems,
+ * and beats best_tour, using num_threads worker threads. Each worker runs a
+ * depth first search on its own stack, or a best first search on its own queue
+ * while the queue has room, pruning partial tours with the bounds the schedule
+ * picks for their depth. It steals work from the other workers once it runs
+ * out, and the process steals work from other processes once all of its
+ * workers have.
+ * Every process in MPI_COMM_WORLD should call this at the same time, and only
+ * the calling thread makes MPI calls.
+ *
+ * @param[in]     graph
+ *     a pointer to the graph being searched
+ * @param[in,out] subproblems
+ *     the partial tours this process should start from, which are removed from
+ *     the stack
+ * @param[in]     num_cities
+ *     the number of cities in the graph
+ * @param[in]     num_threads
+ *     the number of worker threads to search with
+ * @param[in]     schedule
+ *     which lower bound to prune partial tours with at each depth
+ * @param[in]     bounds
+ *     scratch space for the bounds of each worker, built with the same
+ *     schedule and kept by the caller between searches, or NULL for the
+ *     workers to allocate their own for this search only
+ * @param[in]     queue_bytes
+ *     the memory each process may keep queues of partial tours in for a best
+ *     first search, which falls back on depth first once they are full, or 0
+ *     to search depth first throughout
+ * @param[in]     checkpointer
+ *     writes every tour left to search and the best tour found every so often,
+ *     and once more when the search is over, or NULL for no checkpoints
+ * @param[in]     progress
+ *     the number of seconds between reports of how far the search has got,
+ *     which are printed to standard error, or 0 for none
+ * @param[in,out] stats
+ *     the counters the search adds its own to. The tours expanded are always
+ *     counted, and the rest only when built with -DSTATS.
+ * @param[in,out] best_tour
+ *     the best tour known before the search starts, such as one found by
+ *     warm_start, or one with a cost of INT_MAX. It is overwritten with the
+ *     best tour this process finds if that is cheaper.
+ */
+void find_best_tour(Graph *graph, Stack *subproblems, int num_cities,
+		int num_threads, Schedule *schedule, Bounds **bounds,
+		long queue_bytes, Checkpointer *checkpointer, double progress,
+		Stats *stats, Partial_tour *best_tour);
+
+/**
+ * Returns whether extending a partial tour to city would walk a tour the other
+ * way round from one the search keeps. Every tour through an undirected graph
+ * costs the same both ways, and the two directions visit cities 1 and 2 in
+ * opposite orders, so only tours which reach city 1 first are searched. This
+ * halves the tours enumerated, and is always false for directed graphs.
+ *
+ * @param[in]   graph
+ *     a pointer to the graph being searched
+ * @param[in]   tour
+ *     the partial tour about to be extended
+ * @param[in]   city
+ *     the city it would be extended to
+ * @return      true if the extended tour should be skipped, else false
+ */
+Boolean mirrored(Graph *graph, Partial_tour *tour, int city);
+
+#endif /* SEARCH_H */
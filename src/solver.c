@@ -0,0 +1,355 @@
+/**
+ * @file    solver.c
+ * @brief   Branch and bound solving as a library, keeping everything worth
+ *          keeping between solves of a graph whose edges change.
+ * @author  L. Foxcroft
+ * @date    2022-06-24
+ */
+
+#include <stdlib.h>
+#include <limits.h>
+#include <math.h>
+#include <mpi.h>
+#include "solver.h"
+#include "search.h"
+#include "heuristic.h"
+
+/** a solver container */
+struct tsp_solver {
+	/** the graph being solved, which belongs to the caller */
+	Graph *graph;
+	/** the number of cities in the graph */
+	int num_cities;
+	/** the number of worker threads to search with */
+	int num_threads;
+	/** which lower bound to use at each depth */
+	Schedule schedule;
+	/** the memory each process may queue tours in, or 0 for depth first */
+	long queue_bytes;
+	/** the number of subproblems to generate for each process */
+	int oversubscription;
+	/** the scratch space of each worker's bounds, kept between solves */
+	Bounds **bounds;
+	/** the cities of the best tour, in the order they are visited */
+	int *order;
+	/** the best tour of the last solve, or NULL before the first */
+	Partial_tour *tour;
+	/** set once an edge has changed since the last solve */
+	Boolean changed;
+	/** the counters of the last solve, or NULL before the first */
+	Stats *stats;
+};
+
+/** an estimate of the size of a subproblem's subtree, used to share the
+ * subproblems out evenly */
+typedef struct estimate {
+	/** the estimated size, relative to the largest subtree */
+	double size;
+	/** the position of the subproblem in the order it was generated */
+	int index;
+} Estimate;
+
+/*--- function prototypes ----------------------------------------------------*/
+
+static Partial_tour *reuse_tour(Tsp_solver *solver);
+static void share_best_tour(Tsp_solver *solver, Partial_tour *tour);
+static int compare_estimates(const void *a, const void *b);
+
+/*--- solver interface -------------------------------------------------------*/
+
+Tsp_solver *solver_init(Graph *graph, int num_cities, int num_threads,
+		Schedule *schedule, long queue_bytes, int oversubscription)
+{
+	Tsp_solver *solver;
+
+	if (num_cities > MAX_CITIES) {
+		return NULL;
+	}
+	solver = (Tsp_solver *) malloc(sizeof(Tsp_solver));
+	solver->graph = graph;
+	solver->num_cities = num_cities;
+	solver->num_threads = num_threads;
+	solver->schedule = *schedule;
+	solver->queue_bytes = queue_bytes;
+	solver->oversubscription = oversubscription;
+	solver->bounds = (Bounds **) malloc(sizeof(Bounds *) * num_threads);
+	for (int i = 0; i < num_threads; i++) {
+		solver->bounds[i] = bounds_init(graph, num_cities, &solver->schedule);
+	}
+	solver->order = (int *) malloc(sizeof(int) * num_cities);
+	solver->tour = NULL;
+	solver->changed = TRUE;
+	solver->stats = NULL;
+
+	return solver;
+}
+
+Boolean solver_update_edge(Tsp_solver *solver, int from, int to, int weight)
+{
+	if (!set_edge_weight(solver->graph, from, to, weight)) {
+		return FALSE;
+	}
+	for (int i = 0; i < solver->num_threads; i++) {
+		bounds_update_edge(solver->bounds[i], from, to);
+	}
+	solver->changed = TRUE;
+
+	return TRUE;
+}
+
+Partial_tour *solver_resolve(Tsp_solver *solver)
+{
+	int my_rank, comm_sz, num_cities = solver->num_cities;
+	Partial_tour *tour, *fallback, *swap;
+	Stack *stack;
+
+	if (!solver->changed) {
+		return solver->tour;
+	}
+	MPI_Comm_size(MPI_COMM_WORLD, &comm_sz);
+	MPI_Comm_rank(MPI_COMM_WORLD, &my_rank);
+	if (solver->stats != NULL) {
+		stats_free(solver->stats);
+	}
+	solver->stats = stats_init(num_cities, stats_clock());
+
+	/* prune with the last best tour if it is still a tour, since a few
+	 * changed edges seldom leave it far from the best, unless one of its own
+	 * edges got dearer and the heuristics find a cheaper one */
+	tour = reuse_tour(solver);
+	if (tour == NULL || tour_cost(tour) > tour_cost(solver->tour)) {
+		fallback = warm_start(solver->graph, num_cities);
+		if (tour == NULL || tour_cost(fallback) < tour_cost(tour)) {
+			swap = tour;
+			tour = fallback;
+			fallback = swap;
+		}
+		if (fallback != NULL) {
+			free_tour(fallback);
+		}
+	}
+	if (my_rank == 0 && tour_cost(tour) < INT_MAX) {
+		STAT_improved(solver->stats, tour_cost(tour));
+	}
+
+	/* search as tsp does, but with the bounds kept from the last solve */
+	stack = generate_subproblems(solver->graph,
+			comm_sz * solver->oversubscription, num_cities, solver->stats);
+	stack = select_subproblems(stack, comm_sz, my_rank, num_cities,
+			solver->bounds[0], tour_cost(tour));
+	find_best_tour(solver->graph, stack, num_cities, solver->num_threads,
+			&solver->schedule, solver->bounds, solver->queue_bytes, NULL, 0,
+			solver->stats, tour);
+	free_stack(stack);
+
+	share_best_tour(solver, tour);
+	free_tour(tour);
+	solver->changed = FALSE;
+
+	return solver->tour;
+}
+
+Stats *solver_stats(Tsp_solver *solver)
+{
+	return solver->stats;
+}
+
+void solver_free(Tsp_solver *solver)
+{
+	for (int i = 0; i < solver->num_threads; i++) {
+		bounds_free(solver->bounds[i]);
+	}
+	free(solver->bounds);
+	free(solver->order);
+	if (solver->tour != NULL) {
+		free_tour(solver->tour);
+	}
+	if (solver->stats != NULL) {
+		stats_free(solver->stats);
+	}
+	free(solver);
+}
+
+/*--- subproblems ------------------------------------------------------------*/
+
+/** Add initial subproblem to the specified stack and run a breadth first search
+ * until there are at least target subproblems on the stack, so that every
+ * process can be given several to even out the work. The search stops early if
+ * the subproblems left have visited every city, since they can not be split any
+ * further. */
+Stack *generate_subproblems(Graph *graph, int target, int num_cities,
+		Stats *stats)
+{
+	int city, neighbour, cost, search;
+	Adj_iter iter;
+	Partial_tour *tour;
+	Stack *stack;
+
+	/* create stack and add initial subproblem (salesman at city 0) */
+	stack = stack_init(num_cities);
+	tour = tour_init(num_cities);
+	add_city(tour, 0, 0);
+	push_copy(stack, tour);
+
+	/* bfs, in which every tour on the stack has visited as many cities as the
+	 * one at the bottom, or one more */
+	while (stack_size(stack) > 0 && stack_size(stack) < target) {
+		pop_front(stack, tour);
+		if (tour_count(tour) == num_cities) {
+			push_copy(stack, tour);
+			break;
+		}
+		city = last_city(tour);
+		stats->generated++;
+		search = adj(graph, &iter, &city, &neighbour, &cost);
+		while (search) {
+			if (!visited(tour, neighbour) && !mirrored(graph, tour, neighbour)) {
+				add_city(tour, neighbour, cost);
+				push_copy(stack, tour);
+				remove_city(tour, cost);
+			}
+			search = adj(graph, &iter, NULL, &neighbour, &cost);
+		}
+	}
+
+	STAT_high_water(stats, stack_high_water(stack));
+	free_tour(tour);
+
+	return stack;
+}
+
+/** Share the subproblems on the stack out between the processes so that each
+ * gets about the same amount of work, and return this process's share. Every
+ * process generates the same subproblems and makes the same choices, so no
+ * messages are needed. Subproblems whose lower bound reaches limit are dropped,
+ * and the size of the rest of their subtrees is estimated from the number of
+ * cities left to visit and how much of the remaining budget the lower bound
+ * leaves, before they are handed out largest first to the least loaded
+ * process. */
+Stack *select_subproblems(Stack *stack, int comm_sz, int my_rank,
+		int num_cities, Bounds *bounds, int limit)
+{
+	int count = 0, bound, owner;
+	double budget, most = -HUGE_VAL, *load;
+	Partial_tour **tours;
+	Estimate *estimates;
+	Stack *my_problems;
+
+	tours = (Partial_tour **) malloc(sizeof(Partial_tour *)
+			* (stack_size(stack) + 1));
+	estimates = (Estimate *) malloc(sizeof(Estimate) * (stack_size(stack) + 1));
+	load = (double *) calloc(comm_sz, sizeof(double));
+
+	/* estimate the log of each subtree's size as the log of the number of
+	 * ways to finish the tour, scaled by the fraction of the budget which is
+	 * left over once the lower bound has been paid */
+	while (stack_size(stack) > 0) {
+		tours[count] = tour_init(num_cities);
+		pop_front(stack, tours[count]);
+		bound = lower_bound(bounds, tours[count], limit);
+		if (bound >= limit) {
+			free_tour(tours[count]);
+			continue;
+		}
+		set_tour_bound(tours[count], bound);
+		budget = (limit == INT_MAX) ? 1.0 : (double) (limit - bound)
+			/ (limit - tour_cost(tours[count]));
+		estimates[count].size = budget
+			* lgamma(num_cities - tour_count(tours[count]) + 1.0);
+		estimates[count].index = count;
+		most = (estimates[count].size > most) ? estimates[count].size : most;
+		count++;
+	}
+	for (int i = 0; i < count; i++) {
+		estimates[i].size = exp(estimates[i].size - most);
+	}
+	qsort(estimates, count, sizeof(Estimate), compare_estimates);
+
+	/* hand the largest subtree left to the process with the least work,
+	 * keeping the ones which fall to us in the order they were generated */
+	my_problems = stack_init(num_cities);
+	for (int i = 0; i < count; i++) {
+		owner = 0;
+		for (int rank = 1; rank < comm_sz; rank++) {
+			owner = (load[rank] < load[owner]) ? rank : owner;
+		}
+		load[owner] += estimates[i].size;
+		if (owner != my_rank) {
+			free_tour(tours[estimates[i].index]);
+			tours[estimates[i].index] = NULL;
+		}
+	}
+	for (int i = 0; i < count; i++) {
+		if (tours[i] != NULL) {
+			push_copy(my_problems, tours[i]);
+			free_tour(tours[i]);
+		}
+	}
+
+	free(tours);
+	free(estimates);
+	free(load);
+	free_stack(stack);
+
+	return my_problems;
+}
+
+/** Order estimates largest first, and in the order they were generated if they
+ * are the same size, so that every process sorts them the same way */
+static int compare_estimates(const void *a, const void *b)
+{
+	const Estimate *x = (const Estimate *) a, *y = (const Estimate *) b;
+
+	if (x->size != y->size) {
+		return (x->size < y->size) - (x->size > y->size);
+	}
+	return x->index - y->index;
+}
+
+/*--- utility functions ------------------------------------------------------*/
+
+/** Cost the best tour of the last solve again on the graph as it is now, or
+ * return NULL if there was none or one of its edges has been removed */
+static Partial_tour *reuse_tour(Tsp_solver *solver)
+{
+	int n = solver->num_cities;
+
+	if (solver->tour == NULL || tour_cost(solver->tour) == INT_MAX) {
+		return NULL;
+	}
+	for (int i = 0; i < n; i++) {
+		if (edge_weight(solver->graph, solver->order[i],
+					solver->order[(i + 1) % n]) == NO_EDGE) {
+			return NULL;
+		}
+	}
+	return build_tour(solver->graph, n, solver->order);
+}
+
+/** Keep the cheapest tour found by any process as the solver's best tour,
+ * broadcasting its cities from the process which found it */
+static void share_best_tour(Tsp_solver *solver, Partial_tour *tour)
+{
+	int my_rank, mine[2], best[2], n = solver->num_cities;
+
+	MPI_Comm_rank(MPI_COMM_WORLD, &my_rank);
+	mine[0] = tour_cost(tour);
+	mine[1] = my_rank;
+	MPI_Allreduce(mine, best, 1, MPI_2INT, MPI_MINLOC, MPI_COMM_WORLD);
+
+	if (solver->tour != NULL) {
+		free_tour(solver->tour);
+	}
+	if (best[0] == INT_MAX) {
+		solver->tour = tour_init(n);
+		add_city(solver->tour, 0, INT_MAX); /* indicates no tour exists */
+		return;
+	}
+	if (my_rank == best[1]) {
+		for (int i = 0; i < n; i++) {
+			solver->order[i] = tour_city(tour, i);
+		}
+	}
+	MPI_Bcast(solver->order, n, MPI_INT, best[1], MPI_COMM_WORLD);
+	solver->tour = build_tour(solver->graph, n, solver->order);
+}
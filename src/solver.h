@@ -0,0 +1,142 @@
+/**
+ * @file    solver.h
+ * @brief   Branch and bound solving as a library: a solver keeps a graph, the
+ *          scratch space of its bounds and its best tour between solves, so
+ *          that the graph can be solved again cheaply after a few edges change.
+ * @author  L. Foxcroft
+ * @date    2022-06-24
+ */
+
+#ifndef SOLVER_H
+#define SOLVER_H
+
+#include "graph.h"
+#include "stack.h"
+#include "bound.h"
+#include "stats.h"
+
+/** the container structure for a solver */
+typedef struct tsp_solver Tsp_solver;
+
+/*--- function prototypes ----------------------------------------------------*/
+
+/**
+ * Creates a solver for a graph, which the caller keeps and must not change
+ * except through solver_update_edge. Every process in MPI_COMM_WORLD should
+ * create one for the same graph, and make the same calls on it in the same
+ * order.
+ *
+ * @param[in]   graph
+ *     a pointer to the graph to solve
+ * @param[in]   num_cities
+ *     the number of cities in the graph
+ * @param[in]   num_threads
+ *     the number of worker threads to search with
+ * @param[in]   schedule
+ *     which lower bound to prune partial tours with at each depth, which is
+ *     copied
+ * @param[in]   queue_bytes
+ *     the memory each process may keep queues of partial tours in for a best
+ *     first search, or 0 to search depth first
+ * @param[in]   oversubscription
+ *     the number of subproblems to generate for each process
+ * @return      a pointer to the solver, or NULL if the graph has more than
+ *              MAX_CITIES cities, which a tour's route can not hold
+ */
+Tsp_solver *solver_init(Graph *graph, int num_cities, int num_threads,
+		Schedule *schedule, long queue_bytes, int oversubscription);
+
+/**
+ * Changes the weight of the edge between two cities with set_edge_weight, and
+ * brings the per-city bounds kept by the solver up to date. The next call to
+ * solver_resolve searches again.
+ *
+ * @param[in]   solver
+ *     a pointer to the solver
+ * @param[in]   from
+ *     the city the edge starts at
+ * @param[in]   to
+ *     the city the edge ends at
+ * @param[in]   weight
+ *     the new weight of the edge, or NO_EDGE to remove it
+ * @return      true if the edge was changed, else false, as for
+ *              set_edge_weight
+ */
+Boolean solver_update_edge(Tsp_solver *solver, int from, int to, int weight);
+
+/**
+ * Finds the best tour of the graph as it is now. The best tour of the last
+ * solve, costed again, is the incumbent that the search starts pruning with.
+ * If one of its edges has been removed or got dearer, warm_start is run as
+ * well and the cheaper tour is used. If no edge has changed since the last
+ * solve, its tour is returned without searching at all. Every process in
+ * MPI_COMM_WORLD should call this at the same time.
+ *
+ * @param[in]   solver
+ *     a pointer to the solver
+ * @return      the best tour, which is the same on every process, has a cost
+ *              of INT_MAX if there is none, and belongs to the solver until
+ *              the next solve
+ */
+Partial_tour *solver_resolve(Tsp_solver *solver);
+
+/**
+ * Returns the counters of the last solve, for reporting with stats_report.
+ *
+ * @param[in]   solver
+ *     a pointer to the solver
+ * @return      the counters, or NULL if the graph has not been solved yet
+ */
+Stats *solver_stats(Tsp_solver *solver);
+
+/**
+ * Frees the space associated with a solver, but not its graph.
+ *
+ * @param[in]   solver
+ *     the solver to free
+ */
+void solver_free(Tsp_solver *solver);
+
+/**
+ * Runs a breadth first search from city 0 until there are at least target
+ * subproblems, so that every process can be given several to even out the
+ * work. The search stops early if the subproblems left have visited every
+ * city, since they can not be split any further.
+ *
+ * @param[in]     graph
+ *     a pointer to the graph being searched
+ * @param[in]     target
+ *     the number of subproblems wanted
+ * @param[in]     num_cities
+ *     the number of cities in the graph
+ * @param[in,out] stats
+ *     the counters to add the tours expanded to
+ * @return        a stack of the subproblems, in the order they were generated
+ */
+Stack *generate_subproblems(Graph *graph, int target, int num_cities,
+		Stats *stats);
+
+/**
+ * Shares the subproblems on a stack out between the processes by the estimated
+ * size of their subtrees, dropping those which can not beat limit. Every
+ * process makes the same choices from the same subproblems, so no messages are
+ * needed.
+ *
+ * @param[in]   stack
+ *     the subproblems generated by every process, which is freed
+ * @param[in]   comm_sz
+ *     the number of processes
+ * @param[in]   my_rank
+ *     the rank of this process
+ * @param[in]   num_cities
+ *     the number of cities in the graph
+ * @param[in]   bounds
+ *     scratch space to bound the subproblems with
+ * @param[in]   limit
+ *     the cost of the best tour known
+ * @return      this process's share of the subproblems
+ */
+Stack *select_subproblems(Stack *stack, int comm_sz, int my_rank,
+		int num_cities, Bounds *bounds, int limit);
+
+#endif /* SOLVER_H */
@@ -1,54 +1,123 @@
 /**
  * @file    stack.c
- * @brief   A stack of partial tours.
+ * @brief   A stack and a priority queue of partial tours.
  * @author  L. Foxcroft
  * @date    2022-06-03
  */
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
 #include "stack.h"
 
-/** a partial tour container */
+/* number of cities tracked by each word of the visited bitmask */
+#define WORD_BITS 64
+/* number of tours a stack has room for before its arena first grows */
+#define INITIAL_SIZE 64
+
+/** the type the cities of a route are packed into */
+typedef uint16_t City;
+
+/** a partial tour container, which lives in a single block of memory so that
+ * it can be copied with one memcpy */
 struct partial_tour {
-	/** array of cities visited in partial tour (in order) */
-	int *cities;
 	/** number of cities in partial tour */
 	int count;
 	/** sum of the weights of edges traversed in partial tour */
 	int cost;
 	/** the maximum number of cities which can be visited */
 	int max_count;
-	/** array of visited status */
-	int *visited;
+	/** a lower bound on the cost of any tour which extends this one, or
+	 * NO_BOUND */
+	int bound;
+	/** number of words in the visited bitmask */
+	int words;
+	/** visited bitmask, followed by the cities visited in partial tour (in
+	 * order) */
+	uint64_t data[];
 };
 
-/** a stack of partial tours container */
+/** a stack of partial tours container, which stores the tours inline in one
+ * contiguous arena used as a ring buffer, so that tours can be added and
+ * removed at either end in constant time */
 struct stack {
 	/** number of tours on the stack */
 	int size;
-	/** maximum number of tours which can be stored on stack */
+	/** number of tours which fit in the arena before it has to grow, which is
+	 * always a power of two */
+	int max_size;
+	/** the slot of the arena holding the bottom tour */
+	int bottom;
+	/** the most tours which have been on the stack at once */
+	int high_water;
+	/** the number of cities in each tour */
+	int n;
+	/** the number of bytes each tour takes up in the arena */
+	size_t tour_size;
+	/** arena of max_size tours */
+	char *tours;
+};
+
+/** an entry of a priority queue, which points at a tour in the arena so that
+ * sifting only moves the entries */
+typedef struct entry {
+	/** the priority of the tour */
+	int key;
+	/** the number of cities in the tour, to break ties between keys */
+	int count;
+	/** the index of the tour in the arena */
+	int slot;
+} Entry;
+
+/** a priority queue of partial tours container, a binary min-heap of entries
+ * over an arena of tours */
+struct heap {
+	/** number of tours in the queue */
+	int size;
+	/** the most tours the queue may hold */
+	int capacity;
+	/** number of tours which fit in the arena before it has to grow */
 	int max_size;
-	/** array of pointers to partial tours */
-	Partial_tour **tours;
+	/** number of slots of the arena which have ever been used */
+	int used;
+	/** the number of cities in each tour */
+	int n;
+	/** the number of bytes each tour takes up in the arena */
+	size_t tour_size;
+	/** the heap ordered entries */
+	Entry *entries;
+	/** slots of the arena which have been freed by pops */
+	int *free_slots;
+	/** the number of freed slots */
+	int num_free;
+	/** arena of max_size tours */
+	char *tours;
 };
 
+/*--- function prototypes ----------------------------------------------------*/
+
+static size_t tour_bytes(int n);
+static void clear_tour(Partial_tour *tour, int n);
+static City *cities(Partial_tour *tour);
+static Partial_tour *tour_at(Stack *stack, int i);
+static Partial_tour *push_slot(Stack *stack);
+static Partial_tour *heap_tour(Heap *heap, int slot);
+static Boolean before(Entry *a, Entry *b);
+static void sift_up(Heap *heap, int i);
+static void sift_down(Heap *heap, int i);
+
 /*--- stack interface --------------------------------------------------------*/
 
 Partial_tour *tour_init(int n)
 {
-	/* allocate space for tour variable */
-	Partial_tour *tour = (Partial_tour *) malloc(sizeof(Partial_tour));
+	/* allocate space for the tour, its bitmask and its route in one go */
+	Partial_tour *tour = (Partial_tour *) malloc(tour_bytes(n));
 
 	/* set up initial values for partial tour */
-	tour->cities = (int *) malloc(sizeof(int) * n);
-	tour->count = 0;
-	tour->cost = 0;
-	tour->max_count = n;
-	tour->visited = (int *) malloc(sizeof(int) * n);
-	for (int i = 0; i < n; i++) {
-		tour->visited[i] = 0;
-	}
+	clear_tour(tour, n);
 
 	return tour;
 }
@@ -58,13 +127,18 @@ int last_city(Partial_tour *tour)
 	if (tour->count == 0) {
 		return -1;
 	} else {
-		return tour->cities[tour->count-1];
+		return cities(tour)[tour->count-1];
 	}
 }
 
 int visited(Partial_tour *tour, int city)
 {
-	return tour->visited[city];
+	return (tour->data[city / WORD_BITS] >> (city % WORD_BITS)) & 1;
+}
+
+const uint64_t *visited_mask(Partial_tour *tour)
+{
+	return tour->data;
 }
 
 int tour_count(Partial_tour *tour)
@@ -77,26 +151,43 @@ int tour_cost(Partial_tour *tour)
 	return tour->cost;
 }
 
+int tour_city(Partial_tour *tour, int i)
+{
+	return cities(tour)[i];
+}
+
+int tour_bound(Partial_tour *tour)
+{
+	return tour->bound;
+}
+
+void set_tour_bound(Partial_tour *tour, int bound)
+{
+	tour->bound = bound;
+}
+
 void add_city(Partial_tour *tour, int city, int weight)
 {
 	/* add city to partial tour and update weight */
-	tour->cities[tour->count++] = city;
+	cities(tour)[tour->count++] = city;
 	tour->cost += weight;
-	tour->visited[city] = 1;
+	tour->bound = NO_BOUND;
+	tour->data[city / WORD_BITS] |= (uint64_t) 1 << (city % WORD_BITS);
 }
 
 void remove_city(Partial_tour *tour, int weight)
 {
 	/* remove last city in partial tour and update cost */
-	int city = tour->cities[--tour->count];
+	int city = cities(tour)[--tour->count];
 	tour->cost -= weight;
-	tour->visited[city] = 0;
+	tour->bound = NO_BOUND;
+	tour->data[city / WORD_BITS] &= ~((uint64_t) 1 << (city % WORD_BITS));
 }
 
 void print_tour(Partial_tour *tour)
 {
 	for (int i = 0; i < tour->count; i++) {
-		printf("%d", tour->cities[i]);
+		printf("%d", cities(tour)[i]);
 		if (i < tour->count - 1) {
 			printf("->");
 		}
@@ -104,10 +195,15 @@ void print_tour(Partial_tour *tour)
 	printf(" (cost %d)\n", tour->cost);
 }
 
+void copy_tour(Partial_tour *dest, Partial_tour *src)
+{
+	/* only the part of the route which is in use needs to be touched */
+	memcpy(dest, src, offsetof(Partial_tour, data)
+			+ sizeof(uint64_t) * src->words + sizeof(City) * src->count);
+}
+
 void free_tour(Partial_tour *tour)
 {
-	free(tour->cities);
-	free(tour->visited);
 	free(tour);
 }
 
@@ -115,16 +211,17 @@ Stack *stack_init(int n)
 {
 	/* allocate space for the stack variable */
 	Stack *stack = (Stack *) malloc(sizeof(Stack));
-	
-	/* Set up initial values for stack. The number of partial tours on the stack
-	 * is capped at n^2/2, and we would rather allocate the memory now than
-	 * constantly allocate and free partial tours at the top of the stack. */
+
+	/* Set up initial values for stack. The tours live in a single arena which
+	 * doubles in size whenever it fills up, rather than being allocated and
+	 * freed one at a time. */
 	stack->size = 0;
-	stack->max_size = n*n/2;
-	stack->tours = (Partial_tour **) malloc(sizeof(Partial_tour *) * (n*n/2));
-	for (int i = 0; i < stack->max_size; i++) {
-		stack->tours[i] = tour_init(n);
-	}
+	stack->max_size = INITIAL_SIZE;
+	stack->bottom = 0;
+	stack->high_water = 0;
+	stack->n = n;
+	stack->tour_size = tour_bytes(n);
+	stack->tours = (char *) malloc(stack->tour_size * stack->max_size);
 
 	return stack;
 }
@@ -134,88 +231,336 @@ int stack_size(Stack *stack)
 	return stack->size;
 }
 
-void push_copy(Stack *stack, Partial_tour *tour)
+int stack_high_water(Stack *stack)
 {
-	/* get pointer to top of stack and update stack size */
-	Partial_tour *copy = stack->tours[stack->size++];
+	return stack->high_water;
+}
 
+void push_copy(Stack *stack, Partial_tour *tour)
+{
 	/* copy specified tour to the new top of the stack */
-	copy->cost = tour->cost;
-	copy->count = tour->count;
-	for (int i = 0; i < tour->count; i++) {
-		copy->cities[i] = tour->cities[i];
-	}
-	for (int i = 0; i < tour->max_count; i++) {
-		copy->visited[i] = tour->visited[i];
-	}
+	copy_tour(push_slot(stack), tour);
 }
 
 void pop(Stack *stack, Partial_tour *tour)
 {
-	/* update the top of the stack */
-	Partial_tour *copy = stack->tours[--stack->size];
-
 	/* copy the tour which was on top of the stack to 'tour' */
-	tour->cost = copy->cost;
-	tour->count = copy->count;
-	for (int i = 0; i < copy->count; i++) {
-		tour->cities[i] = copy->cities[i];
-	}
-	for (int i = 0; i < copy->max_count; i++) {
-		tour->visited[i] = copy->visited[i];
-	}
+	copy_tour(tour, tour_at(stack, --stack->size));
 }
 
 void pop_front(Stack *stack, Partial_tour *tour)
 {
-	/* remove the bottom element from the stack */
-	Partial_tour *copy = stack->tours[0];
-	for (int i = 0; i < stack->size - 1; i++) {
-		stack->tours[i] = stack->tours[i+1];
+	/* copy the bottom element to tour, and move the bottom of the ring up */
+	copy_tour(tour, tour_at(stack, 0));
+	stack->bottom = (stack->bottom + 1) & (stack->max_size - 1);
+	stack->size--;
+}
+
+void split_stack(Stack *old_stack, Stack *new_stack)
+{
+	int kept = 0;
+	for (int i = 0; i < old_stack->size; i++) {
+		if (i % 2 == 1) {
+			/* copy tour to new stack */
+			push_copy(new_stack, tour_at(old_stack, i));
+		} else if (kept++ < i) {
+			/* move the tour which stays in old stack into the gap created */
+			copy_tour(tour_at(old_stack, kept - 1), tour_at(old_stack, i));
+		}
+	}
+	/* update the original stacks size */
+	old_stack->size = kept;
+}
+
+void copy_stack(Stack *dest, Stack *src)
+{
+	for (int i = 0; i < src->size; i++) {
+		push_copy(dest, tour_at(src, i));
 	}
-	stack->tours[--stack->size] = copy;
+}
+
+void clear_stack(Stack *stack)
+{
+	stack->size = 0;
+	stack->bottom = 0;
+}
 
-	/* copy to tour */
-	tour->cost = copy->cost;
-	tour->count = copy->count;
-	for (int i = 0; i < copy->count; i++) {
-		tour->cities[i] = copy->cities[i];
+int packed_size(Stack *stack)
+{
+	int length = 0;
+	for (int i = 0; i < stack->size; i++) {
+		length += 2 + tour_at(stack, i)->count;
 	}
-	for (int i = 0; i < copy->max_count; i++) {
-		tour->visited[i] = copy->visited[i];
+	return length;
+}
+
+int pack_stack(Stack *stack, int *buffer)
+{
+	int position = 0;
+	Partial_tour *tour;
+
+	/* each tour is packed as its count and cost followed by its cities */
+	for (int i = 0; i < stack->size; i++) {
+		tour = tour_at(stack, i);
+		buffer[position++] = tour->count;
+		buffer[position++] = tour->cost;
+		for (int j = 0; j < tour->count; j++) {
+			buffer[position++] = cities(tour)[j];
+		}
 	}
+	clear_stack(stack);
+
+	return position;
 }
 
-void split_stack(Stack *old_stack, Stack *new_stack)
+Boolean unpack_stack(Stack *stack, int *buffer, int length)
 {
-	Partial_tour *ptr;
-	for (int i = 1; i < old_stack->size; i += 2) {
-		/* copy tour to new stack */
-		push_copy(new_stack, old_stack->tours[i-1]);
-		/* swap the next item which will stay in old stack with gap created */
-		ptr = old_stack->tours[i/2];
-		old_stack->tours[i/2] = old_stack->tours[i];
-		old_stack->tours[i] = ptr;
+	int position = 0, count, city;
+	Partial_tour *copy;
+
+	while (position < length) {
+		/* check the whole tour is there, with room for it and every city in
+		 * the graph, before pushing it */
+		count = buffer[position];
+		if (length - position < 2 || count < 1 || count > stack->n + 1
+				|| count > length - position - 2) {
+			return FALSE;
+		}
+
+		copy = push_slot(stack);
+		clear_tour(copy, stack->n);
+		copy->cost = buffer[position+1];
+		for (int i = 0; i < count; i++) {
+			/* a tour starts from city 0 and visits each city once, only
+			 * coming back to city 0 once it has visited every other */
+			city = buffer[position+2+i];
+			if (city < 0 || city >= stack->n || (i == 0 && city != 0)
+					|| (visited(copy, city) && (city != 0 || i != stack->n))) {
+				stack->size--;
+				return FALSE;
+			}
+			add_city(copy, city, 0);
+		}
+		position += count + 2;
 	}
-	/* update the original stacks size */
-	old_stack->size = old_stack->size - new_stack->size;
+
+	return TRUE;
 }
 
 void print_stack(Stack *stack)
 {
-	printf("size %d\n", stack->size);
+	printf("size %d (high water %d)\n", stack->size, stack->high_water);
 	for (int i = 0; i < stack->size; i++) {
 		printf("%d: ", i);
-		print_tour(stack->tours[i]);
+		print_tour(tour_at(stack, i));
 	}
 }
 
 void free_stack(Stack *stack)
 {
-	for (int i = 0; i < stack->max_size; i++) {
-		free_tour(stack->tours[i]);
-	}
 	free(stack->tours);
 	free(stack);
 }
 
+Heap *heap_init(int n, long max_bytes)
+{
+	Heap *heap = (Heap *) malloc(sizeof(Heap));
+	long capacity;
+
+	heap->size = 0;
+	heap->n = n;
+	heap->tour_size = tour_bytes(n);
+	capacity = max_bytes / (long) (heap->tour_size + sizeof(Entry) + sizeof(int));
+	heap->capacity = (capacity < 1) ? 1 : (capacity > INT_MAX) ? INT_MAX
+		: (int) capacity;
+	heap->max_size = (heap->capacity < INITIAL_SIZE) ? heap->capacity
+		: INITIAL_SIZE;
+	heap->used = 0;
+	heap->entries = (Entry *) malloc(sizeof(Entry) * heap->max_size);
+	heap->free_slots = (int *) malloc(sizeof(int) * heap->max_size);
+	heap->num_free = 0;
+	heap->tours = (char *) malloc(heap->tour_size * heap->max_size);
+
+	return heap;
+}
+
+int heap_size(Heap *heap)
+{
+	return heap->size;
+}
+
+Boolean heap_full(Heap *heap)
+{
+	return heap->size >= heap->capacity;
+}
+
+void heap_push(Heap *heap, Partial_tour *tour, int key)
+{
+	int slot;
+
+	/* reuse a freed slot if there is one, else take a new one, doubling the
+	 * arena (up to the capacity) if it has filled up */
+	if (heap->num_free > 0) {
+		slot = heap->free_slots[--heap->num_free];
+	} else {
+		if (heap->used == heap->max_size) {
+			heap->max_size = (heap->max_size > heap->capacity / 2)
+				? heap->capacity : heap->max_size * 2;
+			heap->entries = (Entry *) realloc(heap->entries,
+					sizeof(Entry) * heap->max_size);
+			heap->free_slots = (int *) realloc(heap->free_slots,
+					sizeof(int) * heap->max_size);
+			heap->tours = (char *) realloc(heap->tours,
+					heap->tour_size * heap->max_size);
+		}
+		slot = heap->used++;
+	}
+
+	copy_tour(heap_tour(heap, slot), tour);
+	heap->entries[heap->size].key = key;
+	heap->entries[heap->size].count = tour->count;
+	heap->entries[heap->size].slot = slot;
+	sift_up(heap, heap->size++);
+}
+
+int heap_pop(Heap *heap, Partial_tour *tour)
+{
+	Entry top = heap->entries[0];
+
+	copy_tour(tour, heap_tour(heap, top.slot));
+	heap->free_slots[heap->num_free++] = top.slot;
+	heap->entries[0] = heap->entries[--heap->size];
+	sift_down(heap, 0);
+
+	return top.key;
+}
+
+void copy_heap(Stack *stack, Heap *heap)
+{
+	for (int i = 0; i < heap->size; i++) {
+		push_copy(stack, heap_tour(heap, heap->entries[i].slot));
+	}
+}
+
+void heap_clear(Heap *heap)
+{
+	heap->size = 0;
+	heap->used = 0;
+	heap->num_free = 0;
+}
+
+void free_heap(Heap *heap)
+{
+	free(heap->entries);
+	free(heap->free_slots);
+	free(heap->tours);
+	free(heap);
+}
+
+/*--- utility functions ------------------------------------------------------*/
+
+/** Return the number of bytes taken up by a tour of n cities, leaving room to
+ * return to the starting city once every city has been visited, and rounded
+ * up so that tours can sit side by side in an arena */
+static size_t tour_bytes(int n)
+{
+	int words = (n + WORD_BITS - 1) / WORD_BITS;
+	size_t size = sizeof(Partial_tour) + sizeof(uint64_t) * words
+		+ sizeof(City) * (n + 1);
+	return (size + sizeof(uint64_t) - 1) / sizeof(uint64_t) * sizeof(uint64_t);
+}
+
+/** Set up an empty tour of n cities in the memory pointed to by tour */
+static void clear_tour(Partial_tour *tour, int n)
+{
+	tour->count = 0;
+	tour->cost = 0;
+	tour->max_count = n;
+	tour->bound = NO_BOUND;
+	tour->words = (n + WORD_BITS - 1) / WORD_BITS;
+	memset(tour->data, 0, sizeof(uint64_t) * tour->words);
+}
+
+/** Return the route of a partial tour, which follows its bitmask */
+static City *cities(Partial_tour *tour)
+{
+	return (City *) (tour->data + tour->words);
+}
+
+/** Return the i-th tour from the bottom of the stack, wrapping around the end
+ * of the arena */
+static Partial_tour *tour_at(Stack *stack, int i)
+{
+	int slot = (stack->bottom + i) & (stack->max_size - 1);
+	return (Partial_tour *) (stack->tours + stack->tour_size * slot);
+}
+
+/** Make room for a tour on top of the stack, growing the arena if it is full,
+ * and return a pointer to it */
+static Partial_tour *push_slot(Stack *stack)
+{
+	if (stack->size == stack->max_size) {
+		/* double the arena, and move the tours which had wrapped around to
+		 * the start of it to just after the old end, so they stay in order */
+		stack->tours = (char *) realloc(stack->tours,
+				stack->tour_size * stack->max_size * 2);
+		memcpy(stack->tours + stack->tour_size * stack->max_size, stack->tours,
+				stack->tour_size * stack->bottom);
+		stack->max_size *= 2;
+	}
+	if (++stack->size > stack->high_water) {
+		stack->high_water = stack->size;
+	}
+	return tour_at(stack, stack->size - 1);
+}
+
+/** Return the tour in the given slot of a priority queue's arena */
+static Partial_tour *heap_tour(Heap *heap, int slot)
+{
+	return (Partial_tour *) (heap->tours + heap->tour_size * slot);
+}
+
+/** Return whether entry a should be popped before entry b: the smaller key
+ * first, and the longer tour if the keys are equal, since it is closer to being
+ * a complete tour */
+static Boolean before(Entry *a, Entry *b)
+{
+	return a->key < b->key || (a->key == b->key && a->count > b->count);
+}
+
+/** Move the i-th entry up the heap until its parent comes before it */
+static void sift_up(Heap *heap, int i)
+{
+	Entry entry = heap->entries[i];
+	int parent;
+
+	while (i > 0) {
+		parent = (i - 1) / 2;
+		if (!before(&entry, &heap->entries[parent])) {
+			break;
+		}
+		heap->entries[i] = heap->entries[parent];
+		i = parent;
+	}
+	heap->entries[i] = entry;
+}
+
+/** Move the i-th entry down the heap until it comes before both children */
+static void sift_down(Heap *heap, int i)
+{
+	Entry entry = heap->entries[i];
+	int child;
+
+	while ((child = 2 * i + 1) < heap->size) {
+		if (child + 1 < heap->size
+				&& before(&heap->entries[child+1], &heap->entries[child])) {
+			child++;
+		}
+		if (!before(&heap->entries[child], &entry)) {
+			break;
+		}
+		heap->entries[i] = heap->entries[child];
+		i = child;
+	}
+	heap->entries[i] = entry;
+}
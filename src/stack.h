@@ -8,16 +8,31 @@
 #ifndef TOUR_H
 #define TOUR_H
 
+#include <stdint.h>
+#include <limits.h>
+#include "boolean.h"
+
+/* the most cities a partial tour can hold, since its route is packed into 16
+ * bit integers */
+#define MAX_CITIES 65535
+/* the bound of a partial tour which has not been bounded since it last changed */
+#define NO_BOUND INT_MIN
+
 /** the structure for a partial tour */
 typedef struct partial_tour Partial_tour;
 
 /** the container structure for a stack of partial tours */
 typedef struct stack Stack;
 
+/** the container structure for a priority queue of partial tours */
+typedef struct heap Heap;
+
 /*--- function prototypes ----------------------------------------------------*/
 
 /**
- * Initialises a partial tour.
+ * Initialises a partial tour. A tour is a single block of memory holding a
+ * bitmask of the cities visited and its route packed into 16 bit integers, so
+ * there may be at most MAX_CITIES cities.
  *
  * @param[in]   n
  *     the number of cities in the graph associated with this tour
@@ -44,6 +59,17 @@ int last_city(Partial_tour *tour);
  */
 int visited(Partial_tour *tour, int city);
 
+/**
+ * Returns the visited bitmask of the specified tour, in which bit i % 64 of
+ * word i / 64 is set once city i has been visited, so that whole words of
+ * cities can be tested at a time.
+ *
+ * @param[in]   tour
+ *     a pointer to the partial tour
+ * @return      the words of the bitmask, with any bits past the last city clear
+ */
+const uint64_t *visited_mask(Partial_tour *tour);
+
 /**
  * Returns the number of cities which have been visited in the specified partial
  * tour.
@@ -63,6 +89,40 @@ int tour_count(Partial_tour *tour);
  */
 int tour_cost(Partial_tour *tour);
 
+/**
+ * Returns the city visited at the specified position of the partial tour.
+ *
+ * @param[in]   tour
+ *     a pointer to the partial tour
+ * @param[in]   i
+ *     the position in the tour, from 0 to tour_count(tour) - 1
+ * @return      the i-th city visited
+ */
+int tour_city(Partial_tour *tour, int i);
+
+/**
+ * Returns the lower bound recorded for the specified partial tour with
+ * set_tour_bound, which is kept when the tour is copied, so that a search need
+ * not bound a tour again when it takes it back off a stack.
+ *
+ * @param[in]   tour
+ *     a pointer to the partial tour
+ * @return      the lower bound, or NO_BOUND if none has been recorded since the
+ *              tour last changed
+ */
+int tour_bound(Partial_tour *tour);
+
+/**
+ * Records a lower bound on the cost of any complete tour which extends the
+ * specified partial tour. Adding or removing a city forgets it.
+ *
+ * @param[in]   tour
+ *     a pointer to the partial tour
+ * @param[in]   bound
+ *     the lower bound
+ */
+void set_tour_bound(Partial_tour *tour, int bound);
+
 /**
  * Adds a city to the specified partial tour.
  *
@@ -93,6 +153,16 @@ void remove_city(Partial_tour *tour, int weight);
  */
 void print_tour(Partial_tour *tour);
 
+/**
+ * Copies one partial tour over another for the same number of cities.
+ *
+ * @param[out]  dest
+ *     the partial tour to overwrite
+ * @param[in]   src
+ *     the partial tour to copy
+ */
+void copy_tour(Partial_tour *dest, Partial_tour *src);
+
 /**
  * Frees the space associated with the specified partial tour.
  *
@@ -102,9 +172,11 @@ void print_tour(Partial_tour *tour);
 void free_tour(Partial_tour *tour);
 
 /**
- * Allocates memory for and returns a stack which should be able to store all
- * the partial tours stored during a depth first search of a graph with n
- * cities. There shouldn't ever be more than n^2/2 tours on the stack.
+ * Allocates memory for and returns a stack of partial tours of a graph with n
+ * cities. The tours are stored inline in a single arena which grows as needed,
+ * so the stack can hold any number of tours. The arena is a ring buffer, so
+ * tours can be pushed and popped at the top and popped at the bottom in
+ * constant time.
  *
  * @param[in]   n
  *     the number of cities in the problem
@@ -121,6 +193,15 @@ Stack *stack_init(int n);
  */
 int stack_size(Stack *stack);
 
+/**
+ * Get the most tours which have been on a stack at once.
+ *
+ * @param[in]   stack
+ *     a pointer to a stack
+ * @return      the high-water mark of the stack's size
+ */
+int stack_high_water(Stack *stack);
+
 /**
  * Copies the data associated with the partial tour and adds it to the top of
  * the stack.
@@ -144,10 +225,10 @@ void push_copy(Stack *stack, Partial_tour *tour);
 void pop(Stack *stack, Partial_tour *tour);
 
 /**
- * Pops the bottom element from the stack and copies the data to the partial tour
- * structure pointed to by tour. A bit ad hoc and inefficient but it will only
- * get used when running a BFS from the inital position to generate enough
- * partial tours to distribute among all the threads.
+ * Pops the bottom element from the stack and copies the data to the partial
+ * tour structure pointed to by tour. This takes constant time, so the stack can
+ * be used as a queue for a breadth first search, and the oldest tours, which
+ * are likely to have the largest subtrees, can be handed out cheaply.
  *
  * @param[in]   stack
  *     the stack whose bottom element should be removed
@@ -159,6 +240,8 @@ void pop_front(Stack *stack, Partial_tour *tour);
 /**
  * Splits the partial tours in old_stack between old_stack and new_stack in a
  * cyclic fashion. This is so that the work is distributed somewhat evenly.
+ * The tours at even positions stay on old_stack, so a stack with a single tour
+ * is left as is.
  *
  * @param[in,out] old_stack
  *     the stack which should be split
@@ -167,6 +250,68 @@ void pop_front(Stack *stack, Partial_tour *tour);
  */
 void split_stack(Stack *old_stack, Stack *new_stack);
 
+/**
+ * Pushes copies of every partial tour on src onto dest, bottom first, leaving
+ * src as it is.
+ *
+ * @param[in,out] dest
+ *     the stack which the copies should be added to
+ * @param[in]     src
+ *     the stack whose tours should be copied
+ */
+void copy_stack(Stack *dest, Stack *src);
+
+/**
+ * Removes every partial tour from the specified stack.
+ *
+ * @param[in,out] stack
+ *     the stack to empty
+ */
+void clear_stack(Stack *stack);
+
+/**
+ * Returns the number of integers needed to pack every partial tour on the
+ * specified stack with pack_stack.
+ *
+ * @param[in]   stack
+ *     a pointer to the stack
+ * @return      the length of the packed stack
+ */
+int packed_size(Stack *stack);
+
+/**
+ * Packs the partial tours on the stack, bottom first, into a contiguous buffer
+ * of integers so that they can be sent to another process. The stack is empty
+ * afterwards.
+ *
+ * @param[in,out] stack
+ *     the stack whose tours should be packed
+ * @param[out]    buffer
+ *     an array of at least packed_size(stack) integers
+ * @return        the number of integers written to buffer
+ */
+int pack_stack(Stack *stack, int *buffer);
+
+/**
+ * Pushes copies of the partial tours which were packed into buffer by
+ * pack_stack onto the specified stack. The tours are checked as they are
+ * unpacked, so that a buffer read from a file cannot write past them, and
+ * unpacking stops at the first which is cut short, has more cities than a tour
+ * can hold, does not start from city 0, visits a city which is not in the
+ * graph, or visits a city twice other than by returning to city 0 at the end.
+ * The costs of the tours are taken as they were packed.
+ *
+ * @param[in,out] stack
+ *     the stack which the tours should be added to
+ * @param[in]     buffer
+ *     the packed tours
+ * @param[in]     length
+ *     the number of integers in buffer
+ * @return        true if every tour was unpacked, or false if one was invalid,
+ *                in which case only the tours before it were pushed
+ */
+Boolean unpack_stack(Stack *stack, int *buffer, int length);
+
 /**
  * Displays the specified stack on standard output.
  *
@@ -183,4 +328,92 @@ void print_stack(Stack *stack);
  */
 void free_stack(Stack *stack);
 
+/**
+ * Allocates memory for and returns a priority queue of partial tours of a graph
+ * with n cities, for a best first search. Like a stack, the tours are stored
+ * inline in an arena which grows as needed, but the queue never takes up more
+ * than about max_bytes.
+ *
+ * @param[in]   n
+ *     the number of cities in the problem
+ * @param[in]   max_bytes
+ *     the most memory the queue's tours may take up
+ * @return      a pointer to a heap structure
+ */
+Heap *heap_init(int n, long max_bytes);
+
+/**
+ * Get the number of tours in a priority queue.
+ *
+ * @param[in]   heap
+ *     a pointer to a priority queue
+ * @return      the size of the queue
+ */
+int heap_size(Heap *heap);
+
+/**
+ * Returns whether a priority queue has used up the memory it was allowed, in
+ * which case no more tours may be pushed until some are popped.
+ *
+ * @param[in]   heap
+ *     a pointer to a priority queue
+ * @return      true if the queue is full, else false
+ */
+Boolean heap_full(Heap *heap);
+
+/**
+ * Copies the data associated with the partial tour into a priority queue which
+ * is not full, to be popped in order of key.
+ *
+ * @param[in]   heap
+ *     a pointer to the priority queue
+ * @param[in]   tour
+ *     the partial tour which should be added to the queue
+ * @param[in]   key
+ *     the priority of the tour, such as a lower bound on the cost of any tour
+ *     which extends it
+ */
+void heap_push(Heap *heap, Partial_tour *tour, int key);
+
+/**
+ * Pops the tour with the smallest key from a priority queue, breaking ties in
+ * favour of the tour which has visited the most cities, and copies the data to
+ * the partial tour structure pointed to by tour.
+ *
+ * @param[in]   heap
+ *     the priority queue whose smallest element should be removed
+ * @param[out]  tour
+ *     a pointer to the partial tour where the element can be copied to
+ * @return      the key of the tour
+ */
+int heap_pop(Heap *heap, Partial_tour *tour);
+
+/**
+ * Pushes copies of every partial tour in a priority queue onto a stack, in no
+ * particular order, leaving the queue as it is.
+ *
+ * @param[in,out] stack
+ *     the stack which the copies should be added to
+ * @param[in]     heap
+ *     the priority queue whose tours should be copied
+ */
+void copy_heap(Stack *stack, Heap *heap);
+
+/**
+ * Removes every tour from a priority queue, for when none of them is worth
+ * searching any more.
+ *
+ * @param[in]   heap
+ *     the priority queue to empty
+ */
+void heap_clear(Heap *heap);
+
+/**
+ * Frees the space associated with the specified priority queue.
+ *
+ * @param[in]   heap
+ *     the priority queue to free
+ */
+void free_heap(Heap *heap);
+
 #endif /* TOUR_H */
@@ -0,0 +1,198 @@
+/**
+ * @file    stats.c
+ * @brief   Counters recording where a search spent its time, gathered on
+ *          process 0 once it is over.
+ * @author  L. Foxcroft
+ * @date    2022-06-23
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+#include "stats.h"
+
+/* the room for improvements allocated at first */
+#define INITIAL_IMPROVEMENTS 16
+/* the counters each process sends process 0, packed as doubles */
+#define SUMMARY_SIZE 7
+
+/** an improvement to the incumbent, and the process which made it */
+typedef struct improvement {
+	/** seconds from the start of the search */
+	double at;
+	/** the cost of the new incumbent */
+	int cost;
+	/** the rank of the process which found it */
+	int rank;
+} Improvement;
+
+/*--- function prototypes ----------------------------------------------------*/
+
+static int compare_improvements(const void *a, const void *b);
+
+/*--- stats interface --------------------------------------------------------*/
+
+Stats *stats_init(int num_cities, double start)
+{
+	Stats *stats = (Stats *) calloc(1, sizeof(Stats));
+
+	stats->start = start;
+	stats->num_cities = num_cities;
+	stats->pruned = (long *) calloc(num_cities + 1, sizeof(long));
+
+	return stats;
+}
+
+double stats_clock(void)
+{
+	struct timespec t;
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+void stats_high_water(Stats *stats, int size)
+{
+	if (size > stats->high_water) {
+		stats->high_water = size;
+	}
+}
+
+void stats_improved(Stats *stats, int cost)
+{
+	if (stats->improvements == stats->capacity) {
+		stats->capacity = (stats->capacity == 0) ? INITIAL_IMPROVEMENTS
+			: 2 * stats->capacity;
+		stats->improved_at = (double *) realloc(stats->improved_at,
+				sizeof(double) * stats->capacity);
+		stats->improved_to = (int *) realloc(stats->improved_to,
+				sizeof(int) * stats->capacity);
+	}
+	stats->improved_at[stats->improvements] = stats_clock() - stats->start;
+	stats->improved_to[stats->improvements++] = cost;
+}
+
+void stats_merge(Stats *stats, Stats *other)
+{
+	stats->expanded += other->expanded;
+	stats->generated += other->generated;
+	stats->dropped += other->dropped;
+	for (int depth = 0; depth <= stats->num_cities; depth++) {
+		stats->pruned[depth] += other->pruned[depth];
+	}
+	stats_high_water(stats, other->high_water);
+	stats->elapsed += other->elapsed;
+	stats->idle += other->idle;
+
+	/* keep the times measured from our own start */
+	for (int i = 0; i < other->improvements; i++) {
+		stats_improved(stats, other->improved_to[i]);
+		stats->improved_at[stats->improvements - 1] = other->improved_at[i]
+			+ other->start - stats->start;
+	}
+}
+
+void stats_report(Stats *stats, int my_rank, int comm_sz)
+{
+	int *counts = NULL, *displs = NULL, *costs = NULL, total = 0;
+	long *pruned = NULL;
+	double summary[SUMMARY_SIZE], *summaries = NULL, *times = NULL, *s;
+	Improvement *improvements;
+
+	if (my_rank == 0) {
+		summaries = (double *) malloc(sizeof(double) * SUMMARY_SIZE * comm_sz);
+		pruned = (long *) malloc(sizeof(long) * (stats->num_cities + 1));
+		counts = (int *) malloc(sizeof(int) * comm_sz);
+		displs = (int *) malloc(sizeof(int) * comm_sz);
+	}
+
+	/* every counter fits in a double without losing anything that matters */
+	summary[0] = stats->expanded;
+	summary[1] = stats->generated;
+	summary[2] = stats->dropped;
+	summary[3] = stats->high_water;
+	summary[4] = stats->improvements;
+	summary[5] = stats->elapsed - stats->idle;
+	summary[6] = stats->idle;
+	MPI_Gather(summary, SUMMARY_SIZE, MPI_DOUBLE, summaries, SUMMARY_SIZE,
+			MPI_DOUBLE, 0, MPI_COMM_WORLD);
+	MPI_Reduce(stats->pruned, pruned, stats->num_cities + 1, MPI_LONG, MPI_SUM,
+			0, MPI_COMM_WORLD);
+
+	/* gather every improvement behind the ones of lower ranked processes */
+	MPI_Gather(&stats->improvements, 1, MPI_INT, counts, 1, MPI_INT, 0,
+			MPI_COMM_WORLD);
+	if (my_rank == 0) {
+		for (int i = 0; i < comm_sz; i++) {
+			displs[i] = total;
+			total += counts[i];
+		}
+		times = (double *) malloc(sizeof(double) * (total + 1));
+		costs = (int *) malloc(sizeof(int) * (total + 1));
+	}
+	MPI_Gatherv(stats->improved_at, stats->improvements, MPI_DOUBLE, times,
+			counts, displs, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+	MPI_Gatherv(stats->improved_to, stats->improvements, MPI_INT, costs,
+			counts, displs, MPI_INT, 0, MPI_COMM_WORLD);
+	if (my_rank != 0) {
+		return;
+	}
+
+	for (int rank = 0; rank < comm_sz; rank++) {
+		s = summaries + SUMMARY_SIZE * rank;
+		fprintf(stderr, "stats rank %d expanded %.0f generated %.0f dropped %.0f"
+				" high_water %.0f improvements %.0f busy %.6f idle %.6f\n",
+				rank, s[0], s[1], s[2], s[3], s[4], s[5], s[6]);
+	}
+	for (int depth = 0; depth <= stats->num_cities; depth++) {
+		if (pruned[depth] > 0) {
+			fprintf(stderr, "stats depth %d pruned %ld\n", depth, pruned[depth]);
+		}
+	}
+
+	/* every process measures from its own start, which is close to the
+	 * others' since they all wait for the graph to be broadcast first */
+	improvements = (Improvement *) malloc(sizeof(Improvement) * (total + 1));
+	for (int rank = 0; rank < comm_sz; rank++) {
+		for (int i = displs[rank]; i < displs[rank] + counts[rank]; i++) {
+			improvements[i].at = times[i];
+			improvements[i].cost = costs[i];
+			improvements[i].rank = rank;
+		}
+	}
+	qsort(improvements, total, sizeof(Improvement), compare_improvements);
+	for (int i = 0; i < total; i++) {
+		fprintf(stderr, "stats improved seconds %.6f cost %d rank %d\n",
+				improvements[i].at, improvements[i].cost, improvements[i].rank);
+	}
+
+	free(improvements);
+	free(summaries);
+	free(pruned);
+	free(counts);
+	free(displs);
+	free(times);
+	free(costs);
+}
+
+void stats_free(Stats *stats)
+{
+	free(stats->pruned);
+	free(stats->improved_at);
+	free(stats->improved_to);
+	free(stats);
+}
+
+/*--- utility functions ------------------------------------------------------*/
+
+/** Order improvements by the time they were found, breaking ties by rank */
+static int compare_improvements(const void *a, const void *b)
+{
+	const Improvement *x = (const Improvement *) a;
+	const Improvement *y = (const Improvement *) b;
+
+	if (x->at != y->at) {
+		return (x->at < y->at) ? -1 : 1;
+	}
+	return x->rank - y->rank;
+}
@@ -0,0 +1,142 @@
+/**
+ * @file    stats.h
+ * @brief   Counters recording where a search spent its time, which are only
+ *          kept when built with -DSTATS so that they cost nothing otherwise.
+ * @author  L. Foxcroft
+ * @date    2022-06-23
+ */
+
+#ifndef STATS_H
+#define STATS_H
+
+#include <mpi.h>
+
+/** counters kept by one worker, or merged for a whole process */
+typedef struct stats {
+	/** when the counters were started, as given by stats_clock */
+	double start;
+	/** the number of cities, so that there are num_cities + 1 depths */
+	int num_cities;
+	/** partial tours expanded by the search, which is always counted */
+	long expanded;
+	/** partial tours expanded while generating subproblems, which is also
+	 * always counted */
+	long generated;
+	/** partial tours pruned by their lower bound, by the number of cities
+	 * they had visited */
+	long *pruned;
+	/** partial tours thrown off a best first queue all at once, when the
+	 * incumbent beats every key left on it */
+	long dropped;
+	/** the most partial tours on any one stack at once */
+	int high_water;
+	/** the number of times the incumbent was improved */
+	int improvements;
+	/** the room for improvements */
+	int capacity;
+	/** seconds from start to each improvement */
+	double *improved_at;
+	/** the cost each improvement lowered the incumbent to */
+	int *improved_to;
+	/** seconds the workers spent searching or looking for work, summed over
+	 * the workers */
+	double elapsed;
+	/** seconds the workers spent looking for work, summed over the workers */
+	double idle;
+} Stats;
+
+#ifdef STATS
+	#define STAT_add(stats, counter, n) ((stats)->counter += (n))
+	#define STAT_pruned(stats, depth) ((stats)->pruned[depth]++)
+	#define STAT_high_water(...) stats_high_water(__VA_ARGS__)
+	#define STAT_improved(...) stats_improved(__VA_ARGS__)
+	#define STAT_start(timer) double timer = stats_clock()
+	#define STAT_since(stats, counter, timer) \
+		((stats)->counter += stats_clock() - (timer))
+	#define STAT_report(...) stats_report(__VA_ARGS__)
+#else
+	#define STAT_add(...)
+	#define STAT_pruned(...)
+	#define STAT_high_water(...)
+	#define STAT_improved(...)
+	#define STAT_start(...)
+	#define STAT_since(...)
+	#define STAT_report(...)
+#endif /* STATS */
+
+/*--- function prototypes ----------------------------------------------------*/
+
+/**
+ * Creates a set of counters, all zero.
+ *
+ * @param[in]   num_cities
+ *     the number of cities in the graph being searched
+ * @param[in]   start
+ *     the time improvements are measured from, as given by stats_clock
+ * @return      a pointer to the counters
+ */
+Stats *stats_init(int num_cities, double start);
+
+/**
+ * Returns the time in seconds from a monotonic clock. Unlike MPI_Wtime, any
+ * thread may call it, so the workers time themselves with it.
+ *
+ * @return      the time in seconds from some fixed point in the past
+ */
+double stats_clock(void);
+
+/**
+ * Raises the high-water mark to size, if it is higher.
+ *
+ * @param[in,out] stats
+ *     a pointer to the counters
+ * @param[in]     size
+ *     the high-water mark of a stack
+ */
+void stats_high_water(Stats *stats, int size);
+
+/**
+ * Records that the incumbent was lowered to cost just now.
+ *
+ * @param[in,out] stats
+ *     a pointer to the counters
+ * @param[in]     cost
+ *     the cost of the new incumbent
+ */
+void stats_improved(Stats *stats, int cost);
+
+/**
+ * Adds one set of counters to another, keeping the higher high-water mark and
+ * every improvement.
+ *
+ * @param[in,out] stats
+ *     a pointer to the counters added to
+ * @param[in]     other
+ *     a pointer to the counters to add
+ */
+void stats_merge(Stats *stats, Stats *other);
+
+/**
+ * Gathers every process's counters on process 0, which prints them to standard
+ * error: a line for each process, the tours pruned at each depth over all of
+ * them, and every improvement to the incumbent in the order they were found.
+ * Every process in MPI_COMM_WORLD should call this at the same time.
+ *
+ * @param[in]   stats
+ *     a pointer to this process's counters
+ * @param[in]   my_rank
+ *     the rank of this process
+ * @param[in]   comm_sz
+ *     the number of processes
+ */
+void stats_report(Stats *stats, int my_rank, int comm_sz);
+
+/**
+ * Frees the memory allocated to a set of counters.
+ *
+ * @param[in]   stats
+ *     a pointer to the counters
+ */
+void stats_free(Stats *stats);
+
+#endif /* STATS_H */
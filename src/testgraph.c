@@ -17,13 +17,17 @@
 int main()
 {
 	char buffer[BUFFERSIZE];
-	int city, neighbour, cost, visited;
+	int city, neighbour, cost, visited, k, count;
+	const int *neighbours, *costs;
 	Graph *graph = NULL;
+	Adj_iter iter;
 
 	printf("Type \"quit <Enter>\" to exit\n");
 	printf("Type \"scan <Enter>\" to read in a new graph\n");
 	printf("Type \"print <Enter>\" to print the current graph\n");
 	printf("Type \"adj <city> <Enter>\" to see which nodes are adjacent to a city\n");
+	printf("Type \"nearest <city> <k> <Enter>\" to see the k nearest neighbours of a city\n");
+	printf("Type \"set <from> <to> <weight> <Enter>\" to change an edge, -1 removing it\n");
 
 	printf(">> ");
 	scanf("%s", buffer);
@@ -39,12 +43,27 @@ int main()
 		} else if (strcmp(buffer, "adj") == 0 && graph != NULL) {
 			scanf("%d", &city);
 			printf("%d: ", city);
-			visited = adj(graph, &city, &neighbour, &cost);
+			visited = adj(graph, &iter, &city, &neighbour, &cost);
 			while (visited) {
 				printf("%d (%d), ", neighbour, cost);
-				visited = adj(graph, NULL, &neighbour, &cost);
+				visited = adj(graph, &iter, NULL, &neighbour, &cost);
 			}
 			printf("\n");
+		} else if (strcmp(buffer, "nearest") == 0 && graph != NULL) {
+			scanf("%d %d", &city, &k);
+			printf("%d: ", city);
+			count = candidates(graph, city, k, &neighbours);
+			neighbours_by_cost(graph, city, NULL, &costs);
+			for (int i = 0; i < count; i++) {
+				printf("%d (%d), ", neighbours[i], costs[i]);
+			}
+			printf("\n");
+		} else if (strcmp(buffer, "set") == 0 && graph != NULL) {
+			scanf("%d %d %d", &city, &neighbour, &cost);
+			if (!set_edge_weight(graph, city, neighbour,
+						(cost < 0) ? NO_EDGE : cost)) {
+				printf("Could not set edge from %d to %d\n", city, neighbour);
+			}
 		}
 		printf(">> ");
 		scanf("%s", buffer);
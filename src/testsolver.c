@@ -0,0 +1,361 @@
+/**
+ * @file    testsolver.c
+ * @brief   A driver program to test re-solving a graph with the solver after
+ *          its edges change, against solving the changed graph from scratch.
+ * @author  L. Foxcroft
+ * @date    2022-06-24
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <limits.h>
+#include <mpi.h>
+#include "graph.h"
+#include "stack.h"
+#include "search.h"
+#include "solver.h"
+#include "bound.h"
+#include "heuristic.h"
+#include "stats.h"
+
+/* subproblems generated for each process */
+#define OVERSUBSCRIPTION 8
+/* the number of changes made to the graph */
+#define STEPS 6
+
+/** the weights of a graph as the driver expects them to be */
+typedef struct weights {
+	/** the number of cities */
+	int v;
+	/** v rows of v weights, NO_EDGE if there is no edge */
+	int *cell;
+} Weights;
+
+/*--- function prototypes ----------------------------------------------------*/
+
+void read_weights(Weights *weights, int my_rank);
+Graph *build_weights(Weights *weights, Backend backend);
+Boolean update(Tsp_solver *solver, Weights *weights, int from, int to,
+		int weight);
+Boolean pick_change(Weights *weights, Partial_tour *tour, int step, int *from,
+		int *to, int *weight);
+int solve_from_scratch(Weights *weights, int num_threads, Schedule *schedule);
+Boolean check_tour(Weights *weights, Partial_tour *tour);
+Boolean test_backend(Weights *original, Backend backend, int num_threads,
+		int my_rank);
+
+/*--- main routine -----------------------------------------------------------*/
+
+/** Reads an edge list from standard in, then for each backend solves it with a
+ * solver, changes a few of its edges one at a time and solves it again after
+ * each change, checking every answer against a search of a graph built from
+ * scratch. Prints a line for every solve, and exits with failure if any
+ * answer differs. */
+int main(int argc, char *argv[])
+{
+	int my_rank, provided, num_threads = 1;
+	Boolean passed;
+	Weights original;
+
+	MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
+	MPI_Comm_rank(MPI_COMM_WORLD, &my_rank);
+	if (argc > 1 && provided >= MPI_THREAD_FUNNELED) {
+		num_threads = atoi(argv[1]) > 0 ? atoi(argv[1]) : 1;
+	}
+
+	read_weights(&original, my_rank);
+	passed = test_backend(&original, GRAPH_DENSE, num_threads, my_rank);
+	passed = test_backend(&original, GRAPH_SPARSE, num_threads, my_rank)
+		&& passed;
+	free(original.cell);
+
+	if (my_rank == 0) {
+		printf("%s\n", passed ? "passed" : "FAILED");
+	}
+	MPI_Finalize();
+
+	return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/*--- tests ------------------------------------------------------------------*/
+
+/** Solve the graph with a solver stored with the given backend, then make each
+ * change in turn and solve it again, comparing every cost with a fresh search.
+ * Solving again without a change must return the last tour without
+ * searching. */
+Boolean test_backend(Weights *original, Backend backend, int num_threads,
+		int my_rank)
+{
+	int from, to, weight, expected;
+	long cells = (long) original->v * original->v;
+	Boolean passed = TRUE, ok;
+	Schedule schedule;
+	Weights copy = {original->v, (int *) malloc(sizeof(int) * cells)}, *weights;
+	Graph *graph;
+	Tsp_solver *solver;
+	Partial_tour *tour;
+	Stats *stats;
+
+	/* the changes are made to a copy, so each backend starts from the same
+	 * graph */
+	for (long k = 0; k < cells; k++) {
+		copy.cell[k] = original->cell[k];
+	}
+	weights = &copy;
+	graph = build_weights(weights, backend);
+	parse_schedule("1tree", &schedule);
+	solver = solver_init(graph, weights->v, num_threads, &schedule, 0,
+			OVERSUBSCRIPTION);
+	tour = solver_resolve(solver);
+
+	for (int step = 0; step <= STEPS; step++) {
+		if (step > 0) {
+			if (!pick_change(weights, tour, step, &from, &to, &weight)) {
+				continue;
+			}
+			if (!update(solver, weights, from, to, weight)) {
+				passed = FALSE;
+			}
+			tour = solver_resolve(solver);
+		}
+
+		expected = solve_from_scratch(weights, num_threads, &schedule);
+		ok = tour_cost(tour) == expected && check_tour(weights, tour);
+		passed = passed && ok;
+		if (my_rank == 0) {
+			printf("%s step %d", backend == GRAPH_DENSE ? "dense" : "sparse",
+					step);
+			if (step > 0) {
+				printf(" set %d-%d to %d", from, to,
+						weight == NO_EDGE ? -1 : weight);
+			}
+			printf(": cost %d expected %d %s\n", tour_cost(tour), expected,
+					ok ? "ok" : "FAILED");
+		}
+	}
+
+	/* nothing has changed, so the last tour and counters are kept */
+	stats = solver_stats(solver);
+	ok = solver_resolve(solver) == tour && solver_stats(solver) == stats;
+	passed = passed && ok;
+	if (my_rank == 0) {
+		printf("%s unchanged: %s\n", backend == GRAPH_DENSE ? "dense" : "sparse",
+				ok ? "ok" : "FAILED");
+	}
+
+	solver_free(solver);
+	free_graph(graph);
+	free(copy.cell);
+
+	return passed;
+}
+
+/** Choose the change for a step from the best tour so far: make an edge of the
+ * tour dearer, remove one, add an edge which was missing, make an edge which
+ * is not on the tour cheap, and then add more of the missing edges, starting
+ * from the last city. Returns false if the graph has no such edge. */
+Boolean pick_change(Weights *weights, Partial_tour *tour, int step, int *from,
+		int *to, int *weight)
+{
+	int v = weights->v, a, b;
+	Boolean found = FALSE;
+
+	if (tour_cost(tour) == INT_MAX && step <= 2) {
+		return FALSE;
+	}
+	switch (step) {
+		case 1:
+			/* a dearer edge of the tour */
+			*from = tour_city(tour, 0);
+			*to = tour_city(tour, 1);
+			*weight = weights->cell[*from * v + *to] * 2 + 50;
+			return TRUE;
+		case 2:
+			/* a missing edge of the tour */
+			*from = tour_city(tour, 1);
+			*to = tour_city(tour, 2);
+			*weight = NO_EDGE;
+			return TRUE;
+		case 3:
+		case 4:
+			/* a new edge, then a cheap edge which is already there and not on
+			 * the tour */
+			for (a = 0; a < v && !found; a++) {
+				for (b = a + 1; b < v && !found; b++) {
+					found = (step == 3)
+						? weights->cell[a * v + b] == NO_EDGE
+						: weights->cell[a * v + b] != NO_EDGE
+							&& weights->cell[a * v + b] > 1;
+					for (int i = 0; found && step == 4
+							&& i < tour_count(tour) - 1; i++) {
+						found = (tour_city(tour, i) != a
+								|| tour_city(tour, i+1) != b)
+							&& (tour_city(tour, i) != b
+								|| tour_city(tour, i+1) != a);
+					}
+					*from = a;
+					*to = b;
+				}
+			}
+			*weight = 1;
+			return found;
+		default:
+			/* another new edge, from the other end */
+			for (a = v - 1; a > 0 && !found; a--) {
+				for (b = a - 1; b >= 0 && !found; b--) {
+					found = weights->cell[a * v + b] == NO_EDGE;
+					*from = a;
+					*to = b;
+				}
+			}
+			*weight = 10 * step;
+			return found;
+	}
+}
+
+/** Change an edge through the solver and in the expected weights */
+Boolean update(Tsp_solver *solver, Weights *weights, int from, int to,
+		int weight)
+{
+	weights->cell[from * weights->v + to] = weight;
+	weights->cell[to * weights->v + from] = weight;
+	return solver_update_edge(solver, from, to, weight);
+}
+
+/** Return the cost of the best tour of the expected weights, found by building
+ * the graph and searching it as tsp does */
+int solve_from_scratch(Weights *weights, int num_threads, Schedule *schedule)
+{
+	int comm_sz, my_rank, cost;
+	Graph *graph = build_weights(weights, GRAPH_AUTO);
+	Stats *stats = stats_init(weights->v, stats_clock());
+	Partial_tour *tour = warm_start(graph, weights->v);
+	Bounds *bounds = bounds_init(graph, weights->v, schedule);
+	Stack *stack;
+
+	MPI_Comm_size(MPI_COMM_WORLD, &comm_sz);
+	MPI_Comm_rank(MPI_COMM_WORLD, &my_rank);
+	stack = generate_subproblems(graph, comm_sz * OVERSUBSCRIPTION, weights->v,
+			stats);
+	stack = select_subproblems(stack, comm_sz, my_rank, weights->v, bounds,
+			tour_cost(tour));
+	bounds_free(bounds);
+	find_best_tour(graph, stack, weights->v, num_threads, schedule, NULL, 0,
+			NULL, 0, stats, tour);
+
+	cost = tour_cost(tour);
+	MPI_Allreduce(MPI_IN_PLACE, &cost, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+
+	free_stack(stack);
+	free_tour(tour);
+	stats_free(stats);
+	free_graph(graph);
+
+	return cost;
+}
+
+/** Return whether a tour visits every city once, returning to city 0, over
+ * edges of the expected weights which add up to its cost, or has a cost of
+ * INT_MAX and no tour is expected */
+Boolean check_tour(Weights *weights, Partial_tour *tour)
+{
+	int v = weights->v, from, to;
+	long cost = 0;
+	Boolean *seen;
+	Boolean ok = tour_count(tour) == v + 1 && tour_city(tour, 0) == 0
+		&& tour_city(tour, v) == 0;
+
+	if (tour_cost(tour) == INT_MAX) {
+		return TRUE;
+	}
+	seen = (Boolean *) calloc(v, sizeof(Boolean));
+	for (int i = 0; ok && i < v; i++) {
+		from = tour_city(tour, i);
+		to = tour_city(tour, i + 1);
+		ok = !seen[from] && weights->cell[from * v + to] != NO_EDGE;
+		seen[from] = TRUE;
+		cost += ok ? weights->cell[from * v + to] : 0;
+	}
+	free(seen);
+
+	return ok && cost == tour_cost(tour);
+}
+
+/*--- graphs -----------------------------------------------------------------*/
+
+/** Process 0 scans an edge list from standard in and broadcasts the weights of
+ * its edges, keeping the cheapest of any parallel edges. */
+void read_weights(Weights *weights, int my_rank)
+{
+	int sizes[2], from, to, weight, *edges = NULL;
+	long cells;
+
+	if (my_rank == 0) {
+		if (scanf("%d %d", &sizes[0], &sizes[1]) != 2 || sizes[0] < 2
+				|| sizes[0] > MAX_CITIES || sizes[1] < 0) {
+			sizes[0] = sizes[1] = 0;
+		}
+		edges = (int *) malloc(sizeof(int) * (3L * sizes[1] + 1));
+		for (int i = 0; i < 3 * sizes[1]; i++) {
+			if (scanf("%d", &edges[i]) != 1) {
+				sizes[0] = sizes[1] = 0;
+			}
+		}
+	}
+	MPI_Bcast(sizes, 2, MPI_INT, 0, MPI_COMM_WORLD);
+	if (sizes[0] == 0) {
+		if (my_rank == 0) {
+			fprintf(stderr, "Could not read graph\n");
+		}
+		MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+	}
+	if (my_rank != 0) {
+		edges = (int *) malloc(sizeof(int) * (3L * sizes[1] + 1));
+	}
+	MPI_Bcast(edges, 3 * sizes[1], MPI_INT, 0, MPI_COMM_WORLD);
+
+	weights->v = sizes[0];
+	cells = (long) weights->v * weights->v;
+	weights->cell = (int *) malloc(sizeof(int) * cells);
+	for (long k = 0; k < cells; k++) {
+		weights->cell[k] = NO_EDGE;
+	}
+	for (int i = 0; i < sizes[1]; i++) {
+		from = edges[3*i];
+		to = edges[3*i+1];
+		weight = edges[3*i+2];
+		if (from < 0 || from >= weights->v || to < 0 || to >= weights->v
+				|| from == to || weight >= weights->cell[from * weights->v + to]) {
+			continue;
+		}
+		weights->cell[from * weights->v + to] = weight;
+		weights->cell[to * weights->v + from] = weight;
+	}
+	free(edges);
+}
+
+/** Build a graph of the expected weights with the given backend */
+Graph *build_weights(Weights *weights, Backend backend)
+{
+	int v = weights->v, e = 0, **edges;
+	Graph *graph;
+
+	edges = (int **) malloc(sizeof(int *) * ((long) v * v / 2 + 1));
+	edges[0] = (int *) malloc(sizeof(int) * 3 * ((long) v * v / 2 + 1));
+	for (int from = 0; from < v; from++) {
+		for (int to = from + 1; to < v; to++) {
+			if (weights->cell[from * v + to] != NO_EDGE) {
+				edges[e] = edges[0] + 3 * e;
+				edges[e][0] = from;
+				edges[e][1] = to;
+				edges[e++][2] = weights->cell[from * v + to];
+			}
+		}
+	}
+	graph = build_graph_backend(v, e, edges, backend);
+
+	free(edges[0]);
+	free(edges);
+
+	return graph;
+}
@@ -8,12 +8,67 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <limits.h>
+#include <string.h>
+#include <unistd.h>
+#include <getopt.h>
 //#include <mpich/mpi.h>
 #include <mpi.h>
 #include "graph.h"
 #include "stack.h"
-
-#define BUFFER_SIZE 1000
+#include "search.h"
+#include "solver.h"
+#include "dp.h"
+#include "bound.h"
+#include "heuristic.h"
+#include "lk.h"
+#include "checkpoint.h"
+#include "instance.h"
+#include "stats.h"
+
+/* bounds used unless -b says otherwise */
+#define DEFAULT_SCHEDULE "1tree"
+/* megabytes a best first search may queue tours in unless -m says otherwise */
+#define DEFAULT_QUEUE_MEGABYTES 256
+/* subproblems generated for each process unless -o says otherwise */
+#define DEFAULT_OVERSUBSCRIPTION 64
+/* seconds between checkpoints unless -i says otherwise */
+#define DEFAULT_CHECKPOINT_INTERVAL 600
+/* number of ints broadcast at a time, and broadcasts allowed in flight */
+#define CHUNK_SIZE 65536
+#define CHUNK_WINDOW 4
+
+/** the ways of solving the problem */
+typedef enum solver {
+	/** depth first branch and bound */
+	SOLVE_DFS,
+	/** Held-Karp dynamic programming */
+	SOLVE_DP,
+	/** iterated Lin-Kernighan, which is not guaranteed to find the best tour */
+	SOLVE_LK
+} Solver;
+
+/** the ways the graph can reach the other processes */
+typedef enum input {
+	/** process 0 could not read the graph */
+	INPUT_INVALID,
+	/** as an edge list */
+	INPUT_EDGES,
+	/** as a list of arcs, for a directed graph */
+	INPUT_ARCS,
+	/** as the coordinates of the cities */
+	INPUT_POINTS
+} Input;
+
+/** the long names of the checkpoint, progress and input options */
+static const struct option long_options[] = {
+	{"graph", required_argument, NULL, 'g'},
+	{"checkpoint", required_argument, NULL, 'c'},
+	{"interval", required_argument, NULL, 'i'},
+	{"resume", no_argument, NULL, 'r'},
+	{"progress", required_argument, NULL, 'p'},
+	{"arcs", no_argument, NULL, 'a'},
+	{NULL, 0, NULL, 0}
+};
 
 /*--- debugging --------------------------------------------------------------*/
 
@@ -32,72 +87,344 @@
 
 /*--- function prototypes ----------------------------------------------------*/
 
-int **init_edge_list(int e);
-void scan_edge_list(int *v, int *e, int ***edges);
-void free_edge_list(int e, int **edges);
-Stack *generate_subproblems(Graph *graph, int comm_sz, int num_cities);
-Stack *select_subproblems(Stack *stack, int comm_sz, int my_rank,
-		int num_cities);
-Partial_tour *find_best_tour(Graph *graph, Stack *subproblems, int num_cities);
-void send_edge_list(int v, int e, int **edges);
-void recv_edge_list(int *v, int *e, int ***edges);
+int usage(char *program, int my_rank);
+void send_edge_list(int v, int e, int **edges, Boolean directed);
+void recv_edge_list(int *v, int *e, int ***edges, Boolean directed);
+void send_points(Points *points);
+void recv_points(Points **points);
+void bcast_ints(int *buffer, long count);
+int find_winner(Partial_tour *tour, int my_rank);
+void send_tour(Partial_tour *tour, int num_cities);
+void recv_tour(Partial_tour **tour, int num_cities, int source);
+void print_result(Partial_tour *tour);
+void print_json(Partial_tour *tour);
+void print_statistics(double seconds, Stats *stats, int my_rank, int comm_sz);
 
 /*--- main routine -----------------------------------------------------------*/
 
-int main()
+int main(int argc, char *argv[])
 {
-	int my_rank = 0, comm_sz = 0;
-	int v, e, **edges, cur_tour, min_tour;
+	int my_rank = 0, comm_sz = 0, provided, opt, num_threads = 1;
+	int v, e, **edges, winner, ok, input_kind, kicks = LK_DEFAULT_KICKS;
+	int oversubscription = DEFAULT_OVERSUBSCRIPTION;
+	Solver solver = SOLVE_DFS;
+	Boolean json = FALSE, best_first = FALSE, resume = FALSE, verbose = FALSE;
+	Boolean arcs = FALSE, directed = FALSE;
+	char *checkpoint_prefix = NULL, *input = NULL, reason[80];
+	double checkpoint_interval = DEFAULT_CHECKPOINT_INTERVAL, progress = 0;
+	Checkpointer *checkpointer = NULL;
+	Instance *instance = NULL;
+	Points *points = NULL;
+	long memory_limit = 0;
+	Stats *stats;
+	Schedule schedule;
+	Bounds *bounds;
 	Graph *graph;
 	Partial_tour *tour;
-	Stack *stack;
+	Stack *stack = NULL;
 
-	/* Start up MPI */
-	MPI_Init(NULL, NULL);
+	/* Start up MPI, which only the main thread of each process will call */
+	MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
 	MPI_Comm_size(MPI_COMM_WORLD, &comm_sz);
 	MPI_Comm_rank(MPI_COMM_WORLD, &my_rank);
 
-	if (my_rank == 0) {
-		/* scan and share edge list */
-		scan_edge_list(&v, &e, &edges);
-		DBG_edge_list(v, e, edges, my_rank);
-		send_edge_list(v, e, edges);
+	/* parse options, the checkpoint and input ones also having long names */
+	parse_schedule(DEFAULT_SCHEDULE, &schedule);
+	while ((opt = getopt_long(argc, argv, "t:s:f:m:o:jvp:b:k:c:i:rg:a",
+					long_options, NULL)) != -1) {
+		switch (opt) {
+			case 't':
+				num_threads = atoi(optarg);
+				break;
+			case 's':
+				if (strcmp(optarg, "dfs") == 0) {
+					solver = SOLVE_DFS;
+				} else if (strcmp(optarg, "dp") == 0) {
+					solver = SOLVE_DP;
+				} else if (strcmp(optarg, "lk") == 0) {
+					solver = SOLVE_LK;
+				} else {
+					return usage(argv[0], my_rank);
+				}
+				break;
+			case 'f':
+				if (strcmp(optarg, "depth") == 0) {
+					best_first = FALSE;
+				} else if (strcmp(optarg, "best") == 0) {
+					best_first = TRUE;
+				} else {
+					return usage(argv[0], my_rank);
+				}
+				break;
+			case 'm':
+				memory_limit = atol(optarg) * 1024 * 1024;
+				break;
+			case 'o':
+				oversubscription = atoi(optarg);
+				break;
+			case 'j':
+				json = TRUE;
+				break;
+			case 'v':
+				verbose = TRUE;
+				break;
+			case 'p':
+				progress = atof(optarg);
+				break;
+			case 'c':
+				checkpoint_prefix = optarg;
+				break;
+			case 'i':
+				checkpoint_interval = atof(optarg);
+				break;
+			case 'r':
+				resume = TRUE;
+				break;
+			case 'g':
+				input = optarg;
+				break;
+			case 'a':
+				arcs = TRUE;
+				break;
+			case 'k':
+				kicks = atoi(optarg);
+				break;
+			case 'b':
+				if (!parse_schedule(optarg, &schedule)) {
+					return usage(argv[0], my_rank);
+				}
+				break;
+			default:
+				return usage(argv[0], my_rank);
+		}
+	}
+	if (num_threads < 1 || provided < MPI_THREAD_FUNNELED) {
+		num_threads = 1;
+	}
+	if (oversubscription < 1) {
+		oversubscription = 1;
+	}
+	if (resume && checkpoint_prefix == NULL) {
+		return usage(argv[0], my_rank);
+	}
+
+	if (input != NULL) {
+		/* every process maps the binary instance from shared storage, so
+		 * nothing needs to be broadcast */
+		instance = map_instance(input);
+		ok = instance != NULL;
+		MPI_Allreduce(MPI_IN_PLACE, &ok, 1, MPI_INT, MPI_LAND, MPI_COMM_WORLD);
+		if (!ok) {
+			if (my_rank == 0) {
+				fprintf(stderr, "Could not read instance %s\n", input);
+			}
+			if (instance != NULL) {
+				unmap_instance(instance);
+			}
+			MPI_Finalize();
+			return EXIT_FAILURE;
+		}
+		v = instance_cities(instance);
+		directed = instance_directed(instance);
+		e = 0;
+		edges = NULL;
 	} else {
-		/* receive edge list from process 0 */
-		recv_edge_list(&v, &e, &edges);
+		/* process 0 scans an edge list or a TSPLIB file */
+		input_kind = INPUT_INVALID;
+		edges = NULL;
+		if (my_rank == 0) {
+			if (scan_instance(stdin, &v, &e, &edges, &points, &directed)) {
+				input_kind = (points != NULL) ? INPUT_POINTS
+					: (directed || arcs) ? INPUT_ARCS : INPUT_EDGES;
+			}
+		}
+		MPI_Bcast(&input_kind, 1, MPI_INT, 0, MPI_COMM_WORLD);
+		if (input_kind == INPUT_INVALID) {
+			if (my_rank == 0) {
+				fprintf(stderr, "Could not read graph\n");
+				free_edge_list(e, edges);
+			}
+			MPI_Finalize();
+			return EXIT_FAILURE;
+		}
+
+		if (input_kind == INPUT_POINTS) {
+			/* share just the coordinates, and every process computes the
+			 * distances straight into its graph */
+			if (my_rank == 0) {
+				send_points(points);
+				free_edge_list(e, edges);
+				edges = NULL;
+			} else {
+				recv_points(&points);
+			}
+			v = points->count;
+			e = 0;
+		} else {
+			directed = input_kind == INPUT_ARCS;
+			if (my_rank == 0) {
+				/* share edge list */
+				DBG_edge_list(v, e, edges, my_rank);
+				send_edge_list(v, e, edges, directed);
+			} else {
+				/* receive edge list from process 0 */
+				recv_edge_list(&v, &e, &edges, directed);
+			}
+		}
 	}
 
-	/* every process should build graph */
-	graph = build_graph(v, e, edges);
-	DBG_graph(graph, my_rank);
+	/* give up before the graph is built if it can not be solved the way that
+	 * was asked for, which every process decides the same way */
+	reason[0] = '\0';
+	if (v > MAX_CITIES) {
+		/* the cities of a tour would not fit in its route */
+		snprintf(reason, sizeof(reason), "Too many cities (%d > %d)", v,
+				MAX_CITIES);
+	} else if (solver == SOLVE_LK && directed) {
+		/* Lin-Kernighan moves reverse paths, which a directed graph charges
+		 * differently for */
+		snprintf(reason, sizeof(reason),
+				"Lin-Kernighan needs an undirected graph");
+	} else if (solver == SOLVE_DP && v > DP_MAX_CITIES) {
+		/* every subset of the cities has to fit in a bitmask */
+		snprintf(reason, sizeof(reason),
+				"Too many cities for dynamic programming (%d > %d)", v,
+				DP_MAX_CITIES);
+	}
+	if (reason[0] != '\0') {
+		if (my_rank == 0) {
+			fprintf(stderr, "%s\n", reason);
+		}
+		if (instance != NULL) {
+			unmap_instance(instance);
+		}
+		if (points != NULL) {
+			free_points(points);
+		}
+		if (edges != NULL) {
+			free_edge_list(e, edges);
+		}
+		MPI_Finalize();
+		return EXIT_FAILURE;
+	}
 
-	/* bfs to find enough subproblems for each process, and pick subproblems
-	 * based on rank */
-	stack = generate_subproblems(graph, comm_sz, v);
-	DBG_stack(stack, my_rank);
-	stack = select_subproblems(stack, comm_sz, my_rank, v);
-	DBG_stack(stack, my_rank);
-
-	/* find the best tour from process's subproblems */
-	tour = find_best_tour(graph, stack, v);
-	if (tour == NULL) {
-		cur_tour = INT_MAX;
+	/* every process should build graph, straight from a mapped instance or
+	 * from the coordinates if it can */
+	if (instance != NULL) {
+		graph = instance_graph(instance);
+		unmap_instance(instance);
+	} else if (points != NULL) {
+		graph = points_graph(points);
+		free_points(points);
 	} else {
-		cur_tour = tour_cost(tour);
+		graph = directed ? build_directed_graph(v, e, edges)
+			: build_graph(v, e, edges);
 	}
+	DBG_graph(graph, my_rank);
+	stats = stats_init(v, stats_clock());
+
+	if (solver == SOLVE_LK) {
+		/* find a good tour with local search, each process kicking it a
+		 * different way and swapping the best tour every so often */
+		tour = lin_kernighan(graph, v, kicks);
+	} else if (solver == SOLVE_DP) {
+		/* solve with dynamic programming, each process and thread taking a
+		 * share of every layer of subsets */
+		tour = held_karp(graph, v, num_threads, memory_limit);
+	} else {
+		if (resume) {
+			/* carry on from every tour the last run had left to search, which
+			 * may have been shared between a different number of processes */
+			tour = tour_init(v);
+			add_city(tour, 0, INT_MAX); /* indicates no tour was found */
+			stack = stack_init(v);
+			ok = checkpoint_resume(checkpoint_prefix, graph, v, stack,
+					tour);
+			MPI_Allreduce(MPI_IN_PLACE, &ok, 1, MPI_INT, MPI_LAND,
+					MPI_COMM_WORLD);
+			if (!ok) {
+				if (my_rank == 0) {
+					fprintf(stderr, "Could not resume from checkpoint %s\n",
+							checkpoint_prefix);
+				}
+				if (edges != NULL) {
+					free_edge_list(e, edges);
+				}
+				free_graph(graph);
+				free_stack(stack);
+				free_tour(tour);
+				stats_free(stats);
+				MPI_Finalize();
+				return EXIT_FAILURE;
+			}
+		} else {
+			/* find a good tour to prune with from the start */
+			tour = warm_start(graph, v);
+			if (my_rank == 0 && tour_cost(tour) < INT_MAX) {
+				STAT_improved(stats, tour_cost(tour));
+			}
 
-	/* send length of best tour to process 0 TODO send tour too */
-	MPI_Reduce(&cur_tour, &min_tour, 1, MPI_INT, MPI_MIN, 0, MPI_COMM_WORLD);
+			/* bfs to find several subproblems for each process */
+			stack = generate_subproblems(graph, comm_sz * oversubscription, v,
+					stats);
+		}
+		DBG_stack(stack, my_rank);
+
+		/* share the subproblems out by the estimated size of their subtrees */
+		bounds = bounds_init(graph, v, &schedule);
+		stack = select_subproblems(stack, comm_sz, my_rank, v, bounds,
+				tour_cost(tour));
+		bounds_free(bounds);
+		DBG_stack(stack, my_rank);
+
+		/* find the best tour from process's subproblems with a pool of
+		 * threads, sharing the cost of the best tour found so far and any
+		 * spare work with the other processes as we go */
+		if (best_first && memory_limit == 0) {
+			memory_limit = DEFAULT_QUEUE_MEGABYTES * 1024L * 1024;
+		}
+		if (checkpoint_prefix != NULL) {
+			checkpointer = checkpoint_init(checkpoint_prefix,
+					checkpoint_interval, graph, v);
+		}
+		find_best_tour(graph, stack, v, num_threads, &schedule, NULL,
+				best_first ? memory_limit : 0, checkpointer, progress, stats,
+				tour);
+		if (checkpointer != NULL) {
+			checkpoint_free(checkpointer);
+		}
+	}
+	/* find the process with the cheapest tour, which sends it to process 0 */
+	winner = find_winner(tour, my_rank);
+	if (winner != 0 && my_rank == winner) {
+		send_tour(tour, v);
+	} else if (winner != 0 && my_rank == 0) {
+		recv_tour(&tour, v, winner);
+	}
 
 	if (my_rank == 0) {
-		printf("%d\n", min_tour);
+		if (json) {
+			print_json(tour);
+		} else {
+			print_result(tour);
+		}
+	}
+	if (verbose) {
+		print_statistics(stats_clock() - stats->start, stats, my_rank, comm_sz);
 	}
+	stats_free(stats);
 
 	/* release allocated resources */
-	free_edge_list(e, edges);
+	if (edges != NULL) {
+		free_edge_list(e, edges);
+	}
 	free_graph(graph);
-	free_stack(stack);
-	free_tour(tour);
+	if (stack != NULL) {
+		free_stack(stack);
+	}
+	if (tour != NULL) {
+		free_tour(tour);
+	}
 
 	/* Shut down MPI */
 	MPI_Finalize();
@@ -107,203 +434,264 @@ int main()
 
 /*--- utility functions ------------------------------------------------------*/
 
-/** Allocates memory for and returns a 2D integer array which can represent an
- * edge list containing e edges. */
-int **init_edge_list(int e)
+/** Print how to run the program and shut down MPI. */
+int usage(char *program, int my_rank)
 {
-	int **edges = (int **) malloc(sizeof(int *) * e);
-	for (int i = 0; i < e; i++) {
-		edges[i] = (int *) malloc(sizeof(int) * 3);
+	if (my_rank == 0) {
+		fprintf(stderr, "usage: %s [-t threads] [-s dfs|dp|lk] [-f depth|best]"
+				" [-m megabytes] [-o subproblems] [-j] [-v] [-p seconds]"
+				" [-b bounds] [-k kicks] [-c checkpoint [-i seconds] [-r]]"
+				" [-g binary | [-a] < graph]\n",
+				program);
+		fprintf(stderr, "bounds: comma separated kind[:depth] stages, where kind"
+				" is cheap, mst, 1tree or assign\n");
 	}
-	return edges;
+	MPI_Finalize();
+	return EXIT_FAILURE;
 }
 
-/** Read graph from standard in into an edge list. */
-void scan_edge_list(int *v, int *e, int ***edges)
+/*--- messaging functions ----------------------------------------------------*/
+
+/** Broadcast the number of vertices and edges to the other processes, followed
+ * by the graph scanned from standard in so that they can reconstruct it. The
+ * graph is sent as the contiguous edge list, or as its distance matrix when
+ * that is smaller, which it is for dense graphs: the upper triangle of an
+ * undirected graph, or every entry off the diagonal of a directed one. */
+void send_edge_list(int v, int e, int **edges, Boolean directed)
 {
-	scanf("%d %d", v, e);
-	*edges = init_edge_list(*e);
-	for (int i = 0; i < *e; i++) {
-		scanf("%d %d %d", &(*edges)[i][0], &(*edges)[i][1], &(*edges)[i][2]);
+	int sizes[3], *cell, from, to;
+	long k, cells = directed ? (long) v * (v - 1) : (long) v * (v - 1) / 2;
+
+	/* broadcast the sizes first so that receivers can allocate space */
+	sizes[0] = v;
+	sizes[1] = e;
+	sizes[2] = cells < 3L * e;
+	MPI_Bcast(sizes, 3, MPI_INT, 0, MPI_COMM_WORLD);
+
+	if (!sizes[2]) {
+		bcast_ints(edges[0], 3L * e);
+		return;
 	}
-}
 
-/** Free the memory associated with specified edge list. */
-void free_edge_list(int e, int **edges)
-{
+	/* fill in the cheapest edge between each pair of cities, or the cheapest
+	 * arc from each city to each other one */
+	cell = (int *) malloc(sizeof(int) * (cells > 0 ? cells : 1));
+	for (k = 0; k < cells; k++) {
+		cell[k] = NO_EDGE;
+	}
 	for (int i = 0; i < e; i++) {
-		free(edges[i]);
+		from = edges[i][0];
+		to = edges[i][1];
+		if (from < 0 || from >= v || to < 0 || to >= v || from == to) {
+			continue;
+		}
+		if (directed) {
+			k = (long) from * (v - 1) + to - (to > from);
+		} else {
+			if (from > to) {
+				from = edges[i][1];
+				to = edges[i][0];
+			}
+			k = (long) from * v - (long) from * (from + 1) / 2
+				+ (to - from - 1);
+		}
+		if (edges[i][2] < cell[k]) {
+			cell[k] = edges[i][2];
+		}
 	}
-	free(edges);
+	bcast_ints(cell, cells);
+	free(cell);
 }
 
-/** Add initial subproblem to the specified stack and run a breadth first search
- * until there are at least comm_sz (communication size) subproblems on the
- * stack. Otherwise we can't give every thread work. */
-Stack *generate_subproblems(Graph *graph, int comm_sz, int num_cities)
+/** Receive the number of vertices, edges and edge list that the master thread
+ * scanned. Then update the worker's values. */
+void recv_edge_list(int *v, int *e, int ***edges, Boolean directed)
 {
-	int city, neighbour, cost, search;
-	Partial_tour *tour;
-	Stack *stack;
-
-	/* create stack and add initial subproblem (salesman at city 0) */
-	stack = stack_init(num_cities);
-	tour = tour_init(num_cities);
-	add_city(tour, 0, 0);
-	push_copy(stack, tour);
-
-	/* bfs */
-	while (stack_size(stack) > 0 && stack_size(stack) < comm_sz) {
-		pop_front(stack, tour);
-		city = last_city(tour);
-		if (city != -1) {
-			search = adj(graph, &city, &neighbour, &cost);
-			while (search) {
-				if (!visited(tour, neighbour)) {
-					add_city(tour, neighbour, cost);
-					push_copy(stack, tour);
-					remove_city(tour, cost);
-				}
-				search = adj(graph, NULL, &neighbour, &cost);
+	int sizes[3], *cell;
+	long k, cells;
+
+	MPI_Bcast(sizes, 3, MPI_INT, 0, MPI_COMM_WORLD);
+	*v = sizes[0];
+
+	if (!sizes[2]) {
+		*e = sizes[1];
+		*edges = init_edge_list(*e);
+		bcast_ints((*edges)[0], 3L * *e);
+		return;
+	}
+
+	/* rebuild the edge list from the cells of the distance matrix, in the
+	 * order they were sent */
+	cells = directed ? (long) *v * (*v - 1) : (long) *v * (*v - 1) / 2;
+	cell = (int *) malloc(sizeof(int) * (cells > 0 ? cells : 1));
+	bcast_ints(cell, cells);
+	*e = 0;
+	for (k = 0; k < cells; k++) {
+		*e += cell[k] != NO_EDGE;
+	}
+	*edges = init_edge_list(*e);
+	k = 0;
+	for (int i = 0, j = 0; i < *v; i++) {
+		for (int to = directed ? 0 : i + 1; to < *v; to++) {
+			if (to == i) {
+				continue;
+			}
+			if (cell[k] != NO_EDGE) {
+				(*edges)[j][0] = i;
+				(*edges)[j][1] = to;
+				(*edges)[j++][2] = cell[k];
 			}
+			k++;
 		}
 	}
+	free(cell);
+}
 
-	free_tour(tour);
+/** Broadcast the metric and coordinates of the cities of a TSPLIB instance,
+ * which takes far less than the distances between them. */
+void send_points(Points *points)
+{
+	int sizes[2];
 
-	return stack;
+	sizes[0] = points->count;
+	sizes[1] = points->metric;
+	MPI_Bcast(sizes, 2, MPI_INT, 0, MPI_COMM_WORLD);
+	MPI_Bcast(points->x, points->count, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+	MPI_Bcast(points->y, points->count, MPI_DOUBLE, 0, MPI_COMM_WORLD);
 }
 
-/** Select the problems on the stack in a cyclic fashion based on process rank.
- * All threads should thus generate the same set of subproblems and pick their
- * ones, rather than the master thread distributing them. */
-Stack *select_subproblems(Stack *stack, int comm_sz, int my_rank,
-		int num_cities)
+/** Receive the cities of a TSPLIB instance that process 0 scanned. */
+void recv_points(Points **points)
 {
-	int cnt;
-	Partial_tour *tour;
-	Stack *my_problems; 
-
-	/* initialize new stack, a tour to help copy this threads subproblems to new
-	 * stack, and a counter to keep track of iterations */
-	my_problems = stack_init(num_cities);
-	tour = tour_init(num_cities);
-	cnt = 0;
-
-	/* remove problems from old stack, adding them to my_problems every comm_sz
-	 * iterations, with my_rank offset so that problems are unique to process
-	 * with unique rank */
-	while (stack_size(stack) > 0) {
-		pop(stack, tour);
-		if (cnt % comm_sz == my_rank) {
-			push_copy(my_problems, tour);
-		}
-		cnt++;
-	}
+	int sizes[2];
 
-	free_tour(tour);
-	free_stack(stack);
-
-	return my_problems;
+	MPI_Bcast(sizes, 2, MPI_INT, 0, MPI_COMM_WORLD);
+	*points = points_init(sizes[0], (Metric) sizes[1]);
+	MPI_Bcast((*points)->x, sizes[0], MPI_DOUBLE, 0, MPI_COMM_WORLD);
+	MPI_Bcast((*points)->y, sizes[0], MPI_DOUBLE, 0, MPI_COMM_WORLD);
 }
 
-/** Search for the best tour from the initial subproblems that the process
- * should have computed. */
-Partial_tour *find_best_tour(Graph *graph, Stack *subproblems, int num_cities)
+/** Broadcast count ints from process 0 in chunks, keeping a few chunks in
+ * flight at once so that they are pipelined through the broadcast tree rather
+ * than sent as one message which has to arrive in full at every level. */
+void bcast_ints(int *buffer, long count)
 {
-	int city, neighbour, cost, search;
-	Partial_tour *best_tour, *helper_tour, *tour_ptr;
-
-	/* initialize tours, helper gets written to during search */
-	best_tour = tour_init(num_cities);
-	add_city(best_tour, 0, INT_MAX); /* indicates that a tour is not possible */
-	helper_tour = tour_init(num_cities);
-	
-	/* iterative dfs */
-	while (stack_size(subproblems) > 0) {
-		pop(subproblems, helper_tour);
-		city = last_city(helper_tour);
-		if (city != -1) { /* ie partial tour is not empty */
-			search = adj(graph, &city, &neighbour, &cost);
-			while (search) {
-				/* add 0 to finish tour if we have visited every city */
-				if (tour_count(helper_tour) == num_cities && neighbour == 0) {
-					add_city(helper_tour, neighbour, cost);
-					if (tour_cost(helper_tour) < tour_cost(best_tour)) {
-						/* swap pointers */
-						tour_ptr = best_tour;
-						best_tour = helper_tour;
-						helper_tour = tour_ptr;
-					}
-				}
-				/* else continue search by visiting neighbouring cities */
-				else if (!visited(helper_tour, neighbour)) {
-					add_city(helper_tour, neighbour, cost);
-					push_copy(subproblems, helper_tour);
-					remove_city(helper_tour, cost);
-				}
-				/* get next neighbour in linked list */
-				search = adj(graph, NULL, &neighbour, &cost);
-			}
+	int chunks = 0, len;
+	MPI_Request requests[CHUNK_WINDOW];
+
+	for (long offset = 0; offset < count; offset += CHUNK_SIZE, chunks++) {
+		if (chunks >= CHUNK_WINDOW) {
+			MPI_Wait(&requests[chunks % CHUNK_WINDOW], MPI_STATUS_IGNORE);
 		}
+		len = (count - offset < CHUNK_SIZE) ? count - offset : CHUNK_SIZE;
+		MPI_Ibcast(buffer + offset, len, MPI_INT, 0, MPI_COMM_WORLD,
+				&requests[chunks % CHUNK_WINDOW]);
 	}
+	MPI_Waitall(chunks < CHUNK_WINDOW ? chunks : CHUNK_WINDOW, requests,
+			MPI_STATUSES_IGNORE);
+}
 
-	free_tour(helper_tour);
+/** Find the rank of the process holding the cheapest tour, preferring the
+ * lowest rank in a tie, with a minloc reduction of (cost, rank) pairs. */
+int find_winner(Partial_tour *tour, int my_rank)
+{
+	int mine[2], best[2];
+
+	mine[0] = (tour == NULL) ? INT_MAX : tour_cost(tour);
+	mine[1] = my_rank;
+	MPI_Allreduce(mine, best, 1, MPI_2INT, MPI_MINLOC, MPI_COMM_WORLD);
 
-	return best_tour;
+	return best[1];
 }
 
+/** Send the cities and cost of a tour to process 0, so that only the winning
+ * tour ever crosses the network. */
+void send_tour(Partial_tour *tour, int num_cities)
+{
+	int *buffer = (int *) malloc(sizeof(int) * (num_cities + 3));
 
-/*--- messaging functions ----------------------------------------------------*/
+	buffer[0] = tour_count(tour);
+	buffer[1] = tour_cost(tour);
+	for (int i = 0; i < tour_count(tour); i++) {
+		buffer[i+2] = tour_city(tour, i);
+	}
+	MPI_Send(buffer, tour_count(tour) + 2, MPI_INT, 0, 0, MPI_COMM_WORLD);
 
-// TODO do some checks so that buffers don't overflow
+	free(buffer);
+}
 
-/** Broadcast the number of vertices, edges and edge list to the other processes
- * so that they can reconstruct the graph scanned from standard in */
-void send_edge_list(int v, int e, int **edges)
+/** Replace the tour of process 0 with the one sent by the winning process. */
+void recv_tour(Partial_tour **tour, int num_cities, int source)
 {
-	int position = 0;
-	int send_buffer[BUFFER_SIZE];
-
-	/* pack vertices and edges into buffer */
-	MPI_Pack(&v, 1, MPI_INT, send_buffer, BUFFER_SIZE, &position,
-			MPI_COMM_WORLD);
-	MPI_Pack(&e, 1, MPI_INT, send_buffer, BUFFER_SIZE, &position,
-			MPI_COMM_WORLD);
+	int *buffer = (int *) malloc(sizeof(int) * (num_cities + 3));
 
-	/* pack the edge list into a contiguous array (because it's easier to
-	 * send than a 2d array) and broadcast to worker threads */
-	for (int i = 0; i < e; i++) {
-		MPI_Pack(edges[i], 3, MPI_INT, send_buffer, BUFFER_SIZE, &position,
-				MPI_COMM_WORLD);
+	MPI_Recv(buffer, num_cities + 3, MPI_INT, source, 0, MPI_COMM_WORLD,
+			MPI_STATUS_IGNORE);
+	if (*tour != NULL) {
+		free_tour(*tour);
+	}
+	*tour = tour_init(num_cities);
+	for (int i = 0; i < buffer[0]; i++) {
+		add_city(*tour, buffer[i+2], (i == 0) ? buffer[1] : 0);
 	}
 
-	/* broadcast to worker threads */
-	MPI_Bcast(send_buffer, position, MPI_PACKED, 0, MPI_COMM_WORLD);
+	free(buffer);
 }
 
-/** Receive the number of vertices, edges and edge list that the master thread
- * scanned. Then update the worker's values. */
-void recv_edge_list(int *v, int *e, int ***edges)
+/*--- output -----------------------------------------------------------------*/
+
+/** Print the best tour followed by its cost on a line of its own, or only
+ * INT_MAX if there is no tour. */
+void print_result(Partial_tour *tour)
 {
-	int position = 0;
-	int recv_buffer[BUFFER_SIZE];
+	if (tour == NULL || tour_cost(tour) == INT_MAX) {
+		printf("%d\n", INT_MAX);
+		return;
+	}
+	print_tour(tour);
+	printf("%d\n", tour_cost(tour));
+}
 
-	/* receive vertices, edges and edge list */
-	MPI_Bcast(recv_buffer, BUFFER_SIZE, MPI_PACKED, 0, MPI_COMM_WORLD);
+/** Print the best tour as a JSON object with its cost and cities, where both
+ * are null if there is no tour. */
+void print_json(Partial_tour *tour)
+{
+	if (tour == NULL || tour_cost(tour) == INT_MAX) {
+		printf("{\"cost\": null, \"tour\": null}\n");
+		return;
+	}
+	printf("{\"cost\": %d, \"tour\": [", tour_cost(tour));
+	for (int i = 0; i < tour_count(tour); i++) {
+		printf((i == 0) ? "%d" : ", %d", tour_city(tour, i));
+	}
+	printf("]}\n");
+}
 
-	/* unpack number of vertices and edges */
-	MPI_Unpack(recv_buffer, BUFFER_SIZE, &position, v, 1, 
-			MPI_INT, MPI_COMM_WORLD);
-	MPI_Unpack(recv_buffer, BUFFER_SIZE, &position, e, 1, 
-			MPI_INT, MPI_COMM_WORLD);
+/** Gather the number of partial tours every process expanded, and print the
+ * total, the time taken to solve the problem once the graph was built, and the
+ * load imbalance (the most tours any process expanded over the mean) to
+ * standard error, as a line which scripts can pick apart. Builds with -DSTATS
+ * go on to print every process's counters. */
+void print_statistics(double seconds, Stats *stats, int my_rank, int comm_sz)
+{
+	long *counts = NULL, total = 0, most = 0;
 
-	/* allocate memory for edge list and unpack into it */
-	*edges = init_edge_list(*e);
-	for (int i = 0; i < *e; i++) {
-		MPI_Unpack(recv_buffer, BUFFER_SIZE, &position, (*edges)[i], 3, 
-				MPI_INT, MPI_COMM_WORLD);
+	if (my_rank == 0) {
+		counts = (long *) malloc(sizeof(long) * comm_sz);
+	}
+	MPI_Gather(&stats->expanded, 1, MPI_LONG, counts, 1, MPI_LONG, 0,
+			MPI_COMM_WORLD);
+	if (my_rank == 0) {
+		for (int i = 0; i < comm_sz; i++) {
+			total += counts[i];
+			most = (counts[i] > most) ? counts[i] : most;
+		}
+		fprintf(stderr, "stats seconds %.6f expanded %ld imbalance %.4f\n",
+				seconds, total,
+				(total > 0) ? (double) most * comm_sz / total : 1.0);
+		free(counts);
 	}
+	STAT_report(stats, my_rank, comm_sz);
 }
 
 /*--- debugging output -------------------------------------------------------*/
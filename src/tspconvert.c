@@ -0,0 +1,54 @@
+/**
+ * @file    tspconvert.c
+ * @brief   Converts a graph from the text edge list format or TSPLIB into the
+ *          binary format which tsp can map with -g.
+ * @author  L. Foxcroft
+ * @date    2022-06-20
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "instance.h"
+
+/*--- main routine -----------------------------------------------------------*/
+
+int main(int argc, char *argv[])
+{
+	int v, e, **edges;
+	Boolean matrix = FALSE, arcs = FALSE, directed, ok;
+	Points *points;
+
+	/* -m writes a full distance matrix, which suits dense graphs, and -a reads
+	 * the edges of a text edge list as arcs */
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "-m") == 0) {
+			matrix = TRUE;
+		} else if (strcmp(argv[i], "-a") == 0) {
+			arcs = TRUE;
+		} else {
+			fprintf(stderr, "usage: %s [-m] [-a] < graph > binary\n", argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (!scan_instance(stdin, &v, &e, &edges, &points, &directed)) {
+		fprintf(stderr, "Could not read graph\n");
+		free_edge_list(e, edges);
+		return EXIT_FAILURE;
+	}
+	/* coordinates are always written out as a distance matrix */
+	if (points != NULL) {
+		ok = write_points(stdout, points);
+		free_points(points);
+	} else {
+		ok = write_instance(stdout, v, e, edges, matrix, directed || arcs);
+	}
+	ok = ok && fflush(stdout) == 0;
+	if (!ok) {
+		perror("tspconvert");
+	}
+	free_edge_list(e, edges);
+
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
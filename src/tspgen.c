@@ -0,0 +1,235 @@
+/**
+ * @file    tspgen.c
+ * @brief   Generates random instances from a seed, for benchmarks which need
+ *          the same graphs every time they are run.
+ * @author  L. Foxcroft
+ * @date    2022-06-22
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <unistd.h>
+
+/* the side of the square cities are placed in */
+#define SIDE 1000.0
+/* the heaviest edge of a uniform or asymmetric instance */
+#define MAX_WEIGHT 1000
+/* the number of cities in each cluster, on average */
+#define CLUSTER_SIZE 8
+/* the spread of the cities around the centre of their cluster */
+#define CLUSTER_SPREAD 25.0
+
+/** the kinds of instance which can be generated */
+typedef enum kind {
+	/** cities placed uniformly in a square, with rounded Euclidean
+	 * distances */
+	KIND_EUCLIDEAN,
+	/** independent uniformly random weights */
+	KIND_UNIFORM,
+	/** cities placed in tight clusters scattered over a square */
+	KIND_CLUSTERED,
+	/** independent weights in each direction, as a TSPLIB ATSP matrix */
+	KIND_ASYMMETRIC
+} Kind;
+
+/*--- function prototypes ----------------------------------------------------*/
+
+static void euclidean(int n, double density, const double *x,
+		const double *y);
+static void uniform(int n, double density);
+static void asymmetric(int n);
+static char *choose_edges(int n, double density, long *e);
+static double random_unit(void);
+static double random_normal(void);
+static int usage(char *program);
+
+/* state of the random number generator */
+static uint64_t state;
+
+/*--- main routine -----------------------------------------------------------*/
+
+int main(int argc, char *argv[])
+{
+	int opt, n, centre, clusters;
+	long seed = 1;
+	double density = 1.0, *x, *y, *cx, *cy;
+	Kind kind = KIND_EUCLIDEAN;
+
+	while ((opt = getopt(argc, argv, "k:s:d:")) != -1) {
+		switch (opt) {
+			case 'k':
+				if (strcmp(optarg, "euclidean") == 0) {
+					kind = KIND_EUCLIDEAN;
+				} else if (strcmp(optarg, "uniform") == 0) {
+					kind = KIND_UNIFORM;
+				} else if (strcmp(optarg, "clustered") == 0) {
+					kind = KIND_CLUSTERED;
+				} else if (strcmp(optarg, "asymmetric") == 0) {
+					kind = KIND_ASYMMETRIC;
+				} else {
+					return usage(argv[0]);
+				}
+				break;
+			case 's':
+				seed = atol(optarg);
+				break;
+			case 'd':
+				density = atof(optarg);
+				break;
+			default:
+				return usage(argv[0]);
+		}
+	}
+	if (optind != argc - 1 || (n = atoi(argv[optind])) < 1 || density <= 0.0
+			|| density > 1.0) {
+		return usage(argv[0]);
+	}
+
+	/* xorshift never leaves 0, so mix the seed into a non-zero state */
+	state = (uint64_t) seed * 0x9E3779B97F4A7C15ULL + 0x2545F4914F6CDD1DULL;
+	state = (state == 0) ? 1 : state;
+
+	if (kind == KIND_UNIFORM) {
+		uniform(n, density);
+	} else if (kind == KIND_ASYMMETRIC) {
+		asymmetric(n);
+	} else {
+		x = (double *) malloc(sizeof(double) * n);
+		y = (double *) malloc(sizeof(double) * n);
+		if (kind == KIND_CLUSTERED) {
+			clusters = (n + CLUSTER_SIZE - 1) / CLUSTER_SIZE;
+			cx = (double *) malloc(sizeof(double) * clusters);
+			cy = (double *) malloc(sizeof(double) * clusters);
+			for (int i = 0; i < clusters; i++) {
+				cx[i] = SIDE * random_unit();
+				cy[i] = SIDE * random_unit();
+			}
+			for (int i = 0; i < n; i++) {
+				centre = (int) (clusters * random_unit());
+				x[i] = cx[centre] + CLUSTER_SPREAD * random_normal();
+				y[i] = cy[centre] + CLUSTER_SPREAD * random_normal();
+			}
+			free(cx);
+			free(cy);
+		} else {
+			for (int i = 0; i < n; i++) {
+				x[i] = SIDE * random_unit();
+				y[i] = SIDE * random_unit();
+			}
+		}
+		euclidean(n, density, x, y);
+		free(x);
+		free(y);
+	}
+
+	return EXIT_SUCCESS;
+}
+
+/*--- instances --------------------------------------------------------------*/
+
+/** Print an edge list joining each pair of points with probability density,
+ * weighted by the distance between them rounded to the nearest int */
+static void euclidean(int n, double density, const double *x,
+		const double *y)
+{
+	long e;
+	char *keep = choose_edges(n, density, &e);
+
+	printf("%d %ld\n", n, e);
+	for (int i = 0; i < n; i++) {
+		for (int j = i + 1; j < n; j++) {
+			if (keep[(long) i * n + j]) {
+				printf("%d %d %d\n", i, j, (int) (hypot(x[i] - x[j],
+								y[i] - y[j]) + 0.5));
+			}
+		}
+	}
+	free(keep);
+}
+
+/** Print an edge list joining each pair of cities with probability density,
+ * with weights drawn uniformly from 1 to MAX_WEIGHT */
+static void uniform(int n, double density)
+{
+	long e;
+	char *keep = choose_edges(n, density, &e);
+
+	printf("%d %ld\n", n, e);
+	for (int i = 0; i < n; i++) {
+		for (int j = i + 1; j < n; j++) {
+			if (keep[(long) i * n + j]) {
+				printf("%d %d %d\n", i, j,
+						1 + (int) (MAX_WEIGHT * random_unit()));
+			}
+		}
+	}
+	free(keep);
+}
+
+/** Print a TSPLIB ATSP instance whose weights are drawn independently in each
+ * direction from 1 to MAX_WEIGHT */
+static void asymmetric(int n)
+{
+	printf("NAME : random%d\nTYPE : ATSP\nDIMENSION : %d\n", n, n);
+	printf("EDGE_WEIGHT_TYPE : EXPLICIT\nEDGE_WEIGHT_FORMAT : FULL_MATRIX\n");
+	printf("EDGE_WEIGHT_SECTION\n");
+	for (int i = 0; i < n; i++) {
+		for (int j = 0; j < n; j++) {
+			printf((j == 0) ? "%d" : " %d", (i == j) ? 0
+					: 1 + (int) (MAX_WEIGHT * random_unit()));
+		}
+		printf("\n");
+	}
+	printf("EOF\n");
+}
+
+/*--- utility functions ------------------------------------------------------*/
+
+/** Decide which pairs of cities to join, each with probability density, before
+ * anything is printed since the edge count comes first; keep[i * n + j] is set
+ * for each edge i < j kept */
+static char *choose_edges(int n, double density, long *e)
+{
+	char *keep = (char *) calloc((size_t) n * n, sizeof(char));
+
+	*e = 0;
+	for (int i = 0; i < n; i++) {
+		for (int j = i + 1; j < n; j++) {
+			keep[(long) i * n + j] = density >= 1.0 || random_unit() < density;
+			*e += keep[(long) i * n + j];
+		}
+	}
+	return keep;
+}
+
+/** Return a random number in [0, 1) */
+static double random_unit(void)
+{
+	state ^= state << 13;
+	state ^= state >> 7;
+	state ^= state << 17;
+	return (state >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/** Return a normally distributed random number with mean 0 and standard
+ * deviation 1, with the Box-Muller transform */
+static double random_normal(void)
+{
+	double u = random_unit();
+
+	while (u == 0.0) {
+		u = random_unit();
+	}
+	return sqrt(-2.0 * log(u)) * cos(2.0 * M_PI * random_unit());
+}
+
+/** Print how to run the program */
+static int usage(char *program)
+{
+	fprintf(stderr, "usage: %s [-k euclidean|uniform|clustered|asymmetric]"
+			" [-s seed] [-d density] cities\n", program);
+	return EXIT_FAILURE;
+}